@@ -0,0 +1,378 @@
+#include "vector.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct Counters {
+    size_t allocations = 0;
+    size_t allocated_bytes = 0;
+    size_t moved_bytes = 0;
+};
+
+Counters counters;
+
+void* CountedAllocate(const size_t size) {
+    ++counters.allocations;
+    counters.allocated_bytes += size;
+    if(void* ptr = std::malloc(size != 0 ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+// Element with a heap-allocated payload and a noexcept move, so both
+// containers relocate it by moving.
+struct String {
+    String() = default;
+
+    explicit String(const size_t id)
+        : value("element number " + std::to_string(id))
+    {
+    }
+
+    String(const String& other)
+        : value(other.value)
+    {
+        counters.moved_bytes += sizeof(String);
+    }
+
+    String(String&& other) noexcept
+        : value(std::move(other.value))
+    {
+        counters.moved_bytes += sizeof(String);
+    }
+
+    String& operator=(const String& other) {
+        value = other.value;
+        counters.moved_bytes += sizeof(String);
+        return *this;
+    }
+
+    String& operator=(String&& other) noexcept {
+        value = std::move(other.value);
+        counters.moved_bytes += sizeof(String);
+        return *this;
+    }
+
+    std::string value;
+};
+
+// Same payload, but the move constructor may throw, so growth has to copy to
+// keep the strong exception guarantee.
+struct ThrowingMove {
+    ThrowingMove() = default;
+
+    explicit ThrowingMove(const size_t id)
+        : value("element number " + std::to_string(id))
+    {
+    }
+
+    ThrowingMove(const ThrowingMove& other)
+        : value(other.value)
+    {
+        counters.moved_bytes += sizeof(ThrowingMove);
+    }
+
+    ThrowingMove(ThrowingMove&& other) noexcept(false)
+        : value(std::move(other.value))
+    {
+        counters.moved_bytes += sizeof(ThrowingMove);
+    }
+
+    ThrowingMove& operator=(const ThrowingMove& other) {
+        value = other.value;
+        counters.moved_bytes += sizeof(ThrowingMove);
+        return *this;
+    }
+
+    ThrowingMove& operator=(ThrowingMove&& other) noexcept(false) {
+        value = std::move(other.value);
+        counters.moved_bytes += sizeof(ThrowingMove);
+        return *this;
+    }
+
+    std::string value;
+};
+
+template<typename T>
+T MakeElement(const size_t id) {
+    if constexpr (std::is_arithmetic_v<T>) {
+        return static_cast<T>(id);
+    } else {
+        return T(id);
+    }
+}
+
+template<typename T>
+size_t Weight(const T& elem) {
+    if constexpr (std::is_arithmetic_v<T>) {
+        return static_cast<size_t>(elem);
+    } else {
+        return elem.value.size();
+    }
+}
+
+// Both containers are driven through the same free functions.
+template<typename T>
+void PushBack(std::vector<T>& v, T&& elem) {
+    v.push_back(std::move(elem));
+}
+
+template<typename T>
+void PushBack(Vector<T>& v, T&& elem) {
+    v.PushBack(std::move(elem));
+}
+
+template<typename T>
+void InsertAt(std::vector<T>& v, const size_t position, T&& elem) {
+    v.insert(v.begin() + position, std::move(elem));
+}
+
+template<typename T>
+void InsertAt(Vector<T>& v, const size_t position, T&& elem) {
+    v.Insert(v.cbegin() + position, std::move(elem));
+}
+
+template<typename T>
+void EraseAt(std::vector<T>& v, const size_t position) {
+    v.erase(v.begin() + position);
+}
+
+template<typename T>
+void EraseAt(Vector<T>& v, const size_t position) {
+    v.Erase(v.cbegin() + position);
+}
+
+template<typename T>
+void Reserve(std::vector<T>& v, const size_t capacity) {
+    v.reserve(capacity);
+}
+
+template<typename T>
+void Reserve(Vector<T>& v, const size_t capacity) {
+    v.Reserve(capacity);
+}
+
+template<typename T>
+size_t SizeOf(const std::vector<T>& v) {
+    return v.size();
+}
+
+template<typename T>
+size_t SizeOf(const Vector<T>& v) {
+    return v.Size();
+}
+
+template<typename Container>
+Container MakeFilled(const size_t count) {
+    using T = typename Container::value_type;
+    Container v;
+    Reserve(v, count);
+    for(size_t i = 0; i != count; ++i) {
+        PushBack(v, MakeElement<T>(i));
+    }
+    return v;
+}
+
+void StartCounting() {
+    counters = Counters{};
+}
+
+// Adds what happened since `before` to `total`; used by benchmarks that
+// rebuild their input with the timer paused.
+void AddSince(Counters& total, const Counters& before) {
+    total.allocations += counters.allocations - before.allocations;
+    total.allocated_bytes += counters.allocated_bytes - before.allocated_bytes;
+    total.moved_bytes += counters.moved_bytes - before.moved_bytes;
+}
+
+void ReportCounters(benchmark::State& state, const size_t items_per_iteration, const Counters& snapshot = counters) {
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * items_per_iteration));
+    state.counters["allocs/op"] = benchmark::Counter(static_cast<double>(snapshot.allocations),
+                                                     benchmark::Counter::kAvgIterations);
+    state.counters["alloc_bytes/op"] = benchmark::Counter(static_cast<double>(snapshot.allocated_bytes),
+                                                          benchmark::Counter::kAvgIterations);
+    state.counters["moved_bytes/op"] = benchmark::Counter(static_cast<double>(snapshot.moved_bytes),
+                                                          benchmark::Counter::kAvgIterations);
+}
+
+template<typename Container>
+void BM_PushBack(benchmark::State& state) {
+    using T = typename Container::value_type;
+    const auto count = static_cast<size_t>(state.range(0));
+    StartCounting();
+    for(auto _ : state) {
+        Container v;
+        for(size_t i = 0; i != count; ++i) {
+            PushBack(v, MakeElement<T>(i));
+        }
+        benchmark::DoNotOptimize(v);
+    }
+    ReportCounters(state, count);
+}
+
+template<typename Container>
+void BM_InsertMiddle(benchmark::State& state) {
+    using T = typename Container::value_type;
+    const auto count = static_cast<size_t>(state.range(0));
+    StartCounting();
+    for(auto _ : state) {
+        Container v;
+        for(size_t i = 0; i != count; ++i) {
+            InsertAt(v, SizeOf(v) / 2, MakeElement<T>(i));
+        }
+        benchmark::DoNotOptimize(v);
+    }
+    ReportCounters(state, count);
+}
+
+template<typename Container>
+void BM_EraseMiddle(benchmark::State& state) {
+    const auto count = static_cast<size_t>(state.range(0));
+    const Container source = MakeFilled<Container>(count);
+    Counters total;
+    for(auto _ : state) {
+        state.PauseTiming();
+        Container v = source;
+        const Counters before = counters;
+        state.ResumeTiming();
+        while(SizeOf(v) != 0) {
+            EraseAt(v, SizeOf(v) / 2);
+        }
+        benchmark::DoNotOptimize(v);
+        AddSince(total, before);
+    }
+    ReportCounters(state, count, total);
+}
+
+template<typename Container>
+void BM_Reserve(benchmark::State& state) {
+    const auto count = static_cast<size_t>(state.range(0));
+    const Container source = MakeFilled<Container>(count);
+    Counters total;
+    for(auto _ : state) {
+        state.PauseTiming();
+        Container v = source;
+        const Counters before = counters;
+        state.ResumeTiming();
+        Reserve(v, count * 2);
+        benchmark::DoNotOptimize(v);
+        AddSince(total, before);
+    }
+    ReportCounters(state, count, total);
+}
+
+template<typename Container>
+void BM_CopyAssign(benchmark::State& state) {
+    const auto count = static_cast<size_t>(state.range(0));
+    const Container source = MakeFilled<Container>(count);
+    Container v;
+    StartCounting();
+    for(auto _ : state) {
+        v = source;
+        benchmark::DoNotOptimize(v);
+        benchmark::ClobberMemory();
+    }
+    ReportCounters(state, count);
+}
+
+template<typename Container>
+void BM_MoveAssign(benchmark::State& state) {
+    const auto count = static_cast<size_t>(state.range(0));
+    Container a = MakeFilled<Container>(count);
+    Container b;
+    StartCounting();
+    for(auto _ : state) {
+        b = std::move(a);
+        benchmark::DoNotOptimize(b);
+        a = std::move(b);
+        benchmark::DoNotOptimize(a);
+    }
+    ReportCounters(state, count);
+}
+
+template<typename Container>
+void BM_Iterate(benchmark::State& state) {
+    const auto count = static_cast<size_t>(state.range(0));
+    const Container v = MakeFilled<Container>(count);
+    StartCounting();
+    for(auto _ : state) {
+        size_t sum = 0;
+        for(const auto& elem : v) {
+            sum += Weight(elem);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    ReportCounters(state, count);
+}
+
+// Sizes 1 .. 10^8 for trivial elements, 1 .. 10^6 for heap-backed ones and
+// 1 .. 10^4 for the quadratic middle insert/erase.
+void LinearSizes(benchmark::internal::Benchmark* bench, const int64_t max_size) {
+    bench->RangeMultiplier(100)->Range(1, max_size)->Unit(benchmark::kMicrosecond);
+}
+
+void TrivialSizes(benchmark::internal::Benchmark* bench) {
+    LinearSizes(bench, 100'000'000);
+}
+
+void ObjectSizes(benchmark::internal::Benchmark* bench) {
+    LinearSizes(bench, 1'000'000);
+}
+
+void QuadraticSizes(benchmark::internal::Benchmark* bench) {
+    LinearSizes(bench, 10'000);
+}
+
+}  // namespace
+
+void* operator new(const size_t size) {
+    return CountedAllocate(size);
+}
+
+void* operator new[](const size_t size) {
+    return CountedAllocate(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t /*size*/) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t /*size*/) noexcept {
+    std::free(ptr);
+}
+
+#define VECTOR_BENCHMARK(name, type, sizes)                              \
+    BENCHMARK_TEMPLATE(name, std::vector<type>)->Apply(sizes);          \
+    BENCHMARK_TEMPLATE(name, Vector<type>)->Apply(sizes)
+
+#define VECTOR_BENCHMARK_ALL_TYPES(name, trivial_sizes, object_sizes)   \
+    VECTOR_BENCHMARK(name, int, trivial_sizes);                         \
+    VECTOR_BENCHMARK(name, String, object_sizes);                       \
+    VECTOR_BENCHMARK(name, ThrowingMove, object_sizes)
+
+VECTOR_BENCHMARK_ALL_TYPES(BM_PushBack, TrivialSizes, ObjectSizes);
+VECTOR_BENCHMARK_ALL_TYPES(BM_InsertMiddle, QuadraticSizes, QuadraticSizes);
+VECTOR_BENCHMARK_ALL_TYPES(BM_EraseMiddle, QuadraticSizes, QuadraticSizes);
+VECTOR_BENCHMARK_ALL_TYPES(BM_Reserve, TrivialSizes, ObjectSizes);
+VECTOR_BENCHMARK_ALL_TYPES(BM_CopyAssign, TrivialSizes, ObjectSizes);
+VECTOR_BENCHMARK_ALL_TYPES(BM_MoveAssign, TrivialSizes, ObjectSizes);
+VECTOR_BENCHMARK_ALL_TYPES(BM_Iterate, TrivialSizes, ObjectSizes);
+
+BENCHMARK_MAIN();
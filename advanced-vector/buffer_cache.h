@@ -0,0 +1,202 @@
+#pragma once
+
+#include "vector.h"
+
+struct BufferCacheStats {
+    // Allocations served from the cache and from the heap.
+    size_t hits = 0;
+    size_t misses = 0;
+    // Deallocations kept in the cache and handed back to the heap.
+    size_t parked = 0;
+    size_t released = 0;
+    size_t cached_bytes = 0;
+};
+
+// Per-thread cache of freed buffers, bucketed by power-of-two size classes
+// from MIN_BLOCK_SIZE to MAX_BLOCK_SIZE bytes. A freed buffer is parked in its
+// class while the thread stays within its byte budget, and the next
+// allocation of that class on the same thread reuses it without touching the
+// global heap. Larger or over-aligned requests bypass the cache.
+class BufferCache {
+public:
+    static constexpr size_t MIN_BLOCK_SIZE = 64;
+    static constexpr size_t MAX_BLOCK_SIZE = size_t{1} << 20;
+    static constexpr size_t DEFAULT_BUDGET = size_t{4} << 20;
+
+    [[nodiscard]] static constexpr bool IsCached(const size_t bytes) noexcept {
+        return bytes <= MAX_BLOCK_SIZE;
+    }
+
+    // Size actually allocated for a request of `bytes`.
+    [[nodiscard]] static constexpr size_t BlockSize(const size_t bytes) noexcept {
+        return IsCached(bytes) ? MIN_BLOCK_SIZE << ClassOf(bytes) : bytes;
+    }
+
+    static void* Allocate(const size_t bytes) {
+        if(void* block = TakeCached(bytes)) {
+            return block;
+        }
+        return operator new(BlockSize(bytes));
+    }
+
+    static void* TryAllocate(const size_t bytes) noexcept {
+        if(void* block = TakeCached(bytes)) {
+            return block;
+        }
+        return operator new(BlockSize(bytes), std::nothrow);
+    }
+
+    static void Deallocate(void* block, const size_t bytes) noexcept {
+        if(block == nullptr) {
+            return;
+        }
+        ThreadState& state = Local();
+        const size_t block_size = BlockSize(bytes);
+        if(!IsCached(bytes) || state.cached_bytes + block_size > state.budget) {
+            ++state.stats.released;
+            operator delete(block);
+            return;
+        }
+        EnsurePurgedAtExit();
+        FreeBlock* free_block = new (block) FreeBlock{state.free_lists[ClassOf(bytes)]};
+        state.free_lists[ClassOf(bytes)] = free_block;
+        state.cached_bytes += block_size;
+        ++state.stats.parked;
+    }
+
+    // Limits the bytes parked by the calling thread; the cache is purged if
+    // it already holds more.
+    static void SetBudget(const size_t bytes) noexcept {
+        ThreadState& state = Local();
+        state.budget = bytes;
+        if(state.cached_bytes > bytes) {
+            Purge();
+        }
+    }
+
+    [[nodiscard]] static size_t GetBudget() noexcept {
+        return Local().budget;
+    }
+
+    [[nodiscard]] static BufferCacheStats GetStats() noexcept {
+        BufferCacheStats stats = Local().stats;
+        stats.cached_bytes = Local().cached_bytes;
+        return stats;
+    }
+
+    static void ResetStats() noexcept {
+        Local().stats = BufferCacheStats{};
+    }
+
+    // Returns every buffer parked by the calling thread to the heap.
+    static void Purge() noexcept {
+        ThreadState& state = Local();
+        for(FreeBlock*& head : state.free_lists) {
+            while(head != nullptr) {
+                FreeBlock* next = head->next;
+                operator delete(head);
+                head = next;
+            }
+        }
+        state.cached_bytes = 0;
+    }
+
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    static constexpr size_t CLASS_COUNT = detail::FloorLog2(MAX_BLOCK_SIZE / MIN_BLOCK_SIZE) + 1;
+
+    // Trivially destructible, so it stays usable while other thread_local
+    // objects are destroyed; the parked buffers are freed by PurgeAtExit.
+    struct ThreadState {
+        FreeBlock* free_lists[CLASS_COUNT];
+        size_t cached_bytes;
+        size_t budget;
+        BufferCacheStats stats;
+    };
+
+    struct PurgeAtExit {
+        ~PurgeAtExit() {
+            Purge();
+            Local().budget = 0;
+        }
+    };
+
+    static ThreadState& Local() noexcept {
+        static thread_local ThreadState state{{}, 0, DEFAULT_BUDGET, {}};
+        return state;
+    }
+
+    static void EnsurePurgedAtExit() noexcept {
+        static thread_local PurgeAtExit purge_at_exit;
+        (void)purge_at_exit;
+    }
+
+    static constexpr size_t ClassOf(const size_t bytes) noexcept {
+        return bytes <= MIN_BLOCK_SIZE ? 0 : detail::FloorLog2((bytes - 1) / MIN_BLOCK_SIZE) + 1;
+    }
+
+    static void* TakeCached(const size_t bytes) noexcept {
+        ThreadState& state = Local();
+        if(!IsCached(bytes)) {
+            ++state.stats.misses;
+            return nullptr;
+        }
+        FreeBlock*& head = state.free_lists[ClassOf(bytes)];
+        if(head == nullptr) {
+            ++state.stats.misses;
+            return nullptr;
+        }
+        FreeBlock* block = head;
+        head = block->next;
+        state.cached_bytes -= BlockSize(bytes);
+        ++state.stats.hits;
+        return block;
+    }
+};
+
+// Allocator that goes through the calling thread's BufferCache, for the
+// short-lived vectors of request-scoped code.
+template<typename T>
+struct CachingAllocator {
+    static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "BufferCache hands out default-aligned blocks");
+
+    using value_type = T;
+    using is_always_equal = std::true_type;
+
+    CachingAllocator() = default;
+
+    template<typename U>
+    CachingAllocator(const CachingAllocator<U>&) noexcept {
+    }
+
+    T* allocate(const size_t count) {
+        if(count > SIZE_MAX / sizeof(T)) {
+            ADVANCED_VECTOR_THROW(std::bad_array_new_length());
+        }
+        return static_cast<T*>(BufferCache::Allocate(count * sizeof(T)));
+    }
+
+    T* try_allocate(const size_t count) noexcept {
+        return count <= SIZE_MAX / sizeof(T) ? static_cast<T*>(BufferCache::TryAllocate(count * sizeof(T))) : nullptr;
+    }
+
+    void deallocate(T* ptr, const size_t count) noexcept {
+        BufferCache::Deallocate(ptr, count * sizeof(T));
+    }
+
+    template<typename U>
+    bool operator==(const CachingAllocator<U>&) const noexcept {
+        return true;
+    }
+
+    template<typename U>
+    bool operator!=(const CachingAllocator<U>&) const noexcept {
+        return false;
+    }
+};
+
+template<typename T, typename GrowthPolicy = DoublingGrowthPolicy>
+using CachedVector = Vector<T, CachingAllocator<T>, GrowthPolicy>;
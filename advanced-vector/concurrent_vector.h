@@ -0,0 +1,255 @@
+#pragma once
+
+#include "vector.h"
+
+#include <atomic>
+#include <climits>
+#include <stdexcept>
+
+// Append-only vector for many concurrent producers. Elements live in
+// segments of FirstSegmentSize, 2 * FirstSegmentSize, 4 * FirstSegmentSize...
+// elements that are never relocated, so references stay valid and readers may
+// iterate while producers keep appending.
+//
+// EmplaceBack claims an index with one atomic increment and publishes the
+// element once it is constructed; the first producer to reach an unallocated
+// segment installs it with a compare-and-swap. Size() counts claimed indices,
+// some of which may still be under construction (or permanently empty if
+// their constructor threw); IsReady tells them apart and iteration skips them.
+template<typename T, typename Allocator = std::allocator<T>, size_t FirstSegmentSize = 64>
+class ConcurrentVector {
+    static_assert(FirstSegmentSize != 0 && (FirstSegmentSize & (FirstSegmentSize - 1)) == 0,
+                  "FirstSegmentSize must be a power of two");
+
+    struct Slot {
+        std::atomic<bool> ready{false};
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T* Get() noexcept {
+            return reinterpret_cast<T*>(storage);
+        }
+    };
+
+    using SlotAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Slot>;
+    using Segment = RawMemory<Slot, SlotAllocator>;
+
+    static constexpr size_t FIRST_SEGMENT_LOG2 = detail::FloorLog2(FirstSegmentSize);
+    static constexpr size_t MAX_SEGMENTS = sizeof(size_t) * CHAR_BIT - FIRST_SEGMENT_LOG2;
+
+public:
+    using value_type = T;
+    using allocator_type = Allocator;
+
+    template<bool IsConst>
+    class BasicIterator {
+        using Owner = std::conditional_t<IsConst, const ConcurrentVector, ConcurrentVector>;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<IsConst, const T*, T*>;
+        using reference = std::conditional_t<IsConst, const T&, T&>;
+
+        BasicIterator(Owner* owner, const size_t index, const size_t end) noexcept
+        : owner_(owner)
+        , index_(index)
+        , end_(end) {
+            SkipUnready();
+        }
+
+        reference operator*() const noexcept {
+            return (*owner_)[index_];
+        }
+
+        pointer operator->() const noexcept {
+            return &(*owner_)[index_];
+        }
+
+        BasicIterator& operator++() noexcept {
+            ++index_;
+            SkipUnready();
+            return *this;
+        }
+
+        BasicIterator operator++(int) noexcept {
+            BasicIterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        [[nodiscard]] size_t Index() const noexcept {
+            return index_;
+        }
+
+        // Iterators past the end of their own snapshot all compare equal, so
+        // begin() and an end() taken after more appends still meet.
+        bool operator==(const BasicIterator& other) const noexcept {
+            return IsEnd() == other.IsEnd() && (IsEnd() || index_ == other.index_);
+        }
+
+        bool operator!=(const BasicIterator& other) const noexcept {
+            return !(*this == other);
+        }
+
+    private:
+        Owner* owner_;
+        size_t index_;
+        size_t end_;
+
+        bool IsEnd() const noexcept {
+            return index_ >= end_;
+        }
+
+        void SkipUnready() noexcept {
+            while(index_ < end_ && !owner_->IsReady(index_)) {
+                ++index_;
+            }
+        }
+    };
+
+    using iterator = BasicIterator<false>;
+    using const_iterator = BasicIterator<true>;
+
+    ConcurrentVector() = default;
+
+    explicit ConcurrentVector(const Allocator& alloc) noexcept
+    : alloc_(alloc) {
+    }
+
+    ConcurrentVector(const ConcurrentVector&) = delete;
+    ConcurrentVector& operator=(const ConcurrentVector&) = delete;
+
+    ~ConcurrentVector() {
+        const size_t size = Size();
+        for(size_t k = 0; k != MAX_SEGMENTS && SegmentStart(k) < size; ++k) {
+            Slot* const slots = segments_[k].load(std::memory_order_acquire);
+            if(slots == nullptr) {
+                continue;
+            }
+            const size_t count = std::min(SegmentSize(k), size - SegmentStart(k));
+            for(size_t i = 0; i != count; ++i) {
+                if(slots[i].ready.load(std::memory_order_relaxed)) {
+                    std::destroy_at(slots[i].Get());
+                }
+            }
+        }
+    }
+
+    // Iteration covers the indices claimed when it starts.
+    iterator begin() noexcept {
+        const size_t size = Size();
+        return iterator(this, 0, size);
+    }
+
+    iterator end() noexcept {
+        const size_t size = Size();
+        return iterator(this, size, size);
+    }
+
+    const_iterator begin() const noexcept {
+        return cbegin();
+    }
+
+    const_iterator end() const noexcept {
+        return cend();
+    }
+
+    const_iterator cbegin() const noexcept {
+        const size_t size = Size();
+        return const_iterator(this, 0, size);
+    }
+
+    const_iterator cend() const noexcept {
+        const size_t size = Size();
+        return const_iterator(this, size, size);
+    }
+
+    [[nodiscard]] size_t Size() const noexcept {
+        return size_.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] size_t Capacity() const noexcept {
+        size_t k = 0;
+        while(k != MAX_SEGMENTS && segments_[k].load(std::memory_order_acquire) != nullptr) {
+            ++k;
+        }
+        return SegmentStart(k);
+    }
+
+    [[nodiscard]] bool IsReady(const size_t index) const noexcept {
+        const size_t k = SegmentOf(index);
+        const Slot* const slots = segments_[k].load(std::memory_order_acquire);
+        return slots != nullptr && slots[index - SegmentStart(k)].ready.load(std::memory_order_acquire);
+    }
+
+    // Allocates the segments for `new_capacity` elements up front, so that
+    // producers never have to.
+    void Reserve(const size_t new_capacity) {
+        for(size_t k = 0; k != MAX_SEGMENTS && SegmentStart(k) < new_capacity; ++k) {
+            GetSegment(k);
+        }
+    }
+
+    template<typename... Args>
+    T& EmplaceBack(Args&&... args) {
+        const size_t index = size_.fetch_add(1, std::memory_order_acq_rel);
+        if(index > SIZE_MAX - FirstSegmentSize) {
+            ADVANCED_VECTOR_THROW(std::length_error("ConcurrentVector is full"));
+        }
+        const size_t k = SegmentOf(index);
+        Slot& slot = GetSegment(k)[index - SegmentStart(k)];
+        T* elem = new (slot.Get()) T(std::forward<Args>(args)...);
+        slot.ready.store(true, std::memory_order_release);
+        return *elem;
+    }
+
+    template<typename Type>
+    T& PushBack(Type&& elem) {
+        return EmplaceBack(std::forward<Type>(elem));
+    }
+
+    const T& operator[](const size_t index) const noexcept {
+        return const_cast<ConcurrentVector&>(*this)[index];
+    }
+
+    T& operator[](const size_t index) noexcept {
+        assert(IsReady(index));
+        const size_t k = SegmentOf(index);
+        return *segments_[k].load(std::memory_order_acquire)[index - SegmentStart(k)].Get();
+    }
+
+private:
+    ADVANCED_VECTOR_NO_UNIQUE_ADDRESS SlotAllocator alloc_;
+    std::atomic<size_t> size_{0};
+    std::atomic<Slot*> segments_[MAX_SEGMENTS] = {};
+    // Owners of the published segments; blocks_[k] is written once, by the
+    // producer whose compare-and-swap installed segments_[k].
+    Segment blocks_[MAX_SEGMENTS];
+
+    static constexpr size_t SegmentOf(const size_t index) noexcept {
+        return detail::FloorLog2(index + FirstSegmentSize) - FIRST_SEGMENT_LOG2;
+    }
+
+    static constexpr size_t SegmentStart(const size_t k) noexcept {
+        return (FirstSegmentSize << k) - FirstSegmentSize;
+    }
+
+    static constexpr size_t SegmentSize(const size_t k) noexcept {
+        return FirstSegmentSize << k;
+    }
+
+    Slot* GetSegment(const size_t k) {
+        if(Slot* slots = segments_[k].load(std::memory_order_acquire)) {
+            return slots;
+        }
+        Segment block(SegmentSize(k), alloc_);
+        std::uninitialized_value_construct_n(block.GetAddress(), SegmentSize(k));
+        Slot* expected = nullptr;
+        if(segments_[k].compare_exchange_strong(expected, block.GetAddress(), std::memory_order_acq_rel)) {
+            blocks_[k] = std::move(block);
+            return blocks_[k].GetAddress();
+        }
+        return expected;
+    }
+};
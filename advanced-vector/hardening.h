@@ -0,0 +1,319 @@
+#pragma once
+
+// Hardened builds of Vector, selected before including vector.h:
+//   ADVANCED_VECTOR_HARDENED
+//       bounds checks on element access and erase, and generation-counted
+//       iterators that report use after the vector reallocated, shifted or
+//       removed elements;
+//   ADVANCED_VECTOR_HARDENED_SAMPLED
+//       the same bounds checks, but only one iterator in
+//       GetHardeningSamplePeriod() is tracked, which keeps the cost low
+//       enough for canary builds under production load.
+// Failed checks call the HardeningHandler, which aborts by default. Every
+// translation unit of a program must use the same mode, since it changes
+// the layout of Vector and of its iterators.
+//
+// A tracked iterator remembers the generation of its vector and the range
+// of elements when it was obtained. The generation changes on any
+// operation that may move or destroy elements, so iterators in front of an
+// insert or erase are conservatively reported as well, and iterators of a
+// destroyed vector are not detected.
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+
+#if defined(ADVANCED_VECTOR_HARDENED) || defined(ADVANCED_VECTOR_HARDENED_SAMPLED)
+#define ADVANCED_VECTOR_CHECKED
+#define ADVANCED_VECTOR_CHECK(condition, message) detail::hardening::Check(condition, message)
+#else
+#define ADVANCED_VECTOR_CHECK(condition, message) assert((condition) && message)
+#endif
+
+using HardeningHandler = void (*)(const char* message) noexcept;
+
+namespace detail::hardening {
+
+inline void AbortHandler(const char* message) noexcept {
+    std::fprintf(stderr, "advanced-vector: %s\n", message);
+    std::abort();
+}
+
+inline std::atomic<HardeningHandler> handler{&AbortHandler};
+inline std::atomic<uint32_t> sample_period{1024};
+
+[[nodiscard]] constexpr bool IsConstantEvaluated() noexcept {
+#ifdef __cpp_lib_is_constant_evaluated
+    return std::is_constant_evaluated();
+#else
+    return false;
+#endif
+}
+
+inline void Fail(const char* message) noexcept {
+    handler.load(std::memory_order_acquire)(message);
+}
+
+// Fails constant evaluation instead of calling the handler.
+ADVANCED_VECTOR_CONSTEXPR void Check(const bool condition, const char* message) noexcept {
+    if(!condition) {
+        Fail(message);
+    }
+}
+
+// True for one call in `sample_period` on each thread. A countdown left
+// from a longer period is cut short, so a new period applies at once.
+inline bool Sample() noexcept {
+#ifdef ADVANCED_VECTOR_HARDENED_SAMPLED
+    const uint32_t period = sample_period.load(std::memory_order_relaxed);
+    if(period == 0) {
+        return false;
+    }
+    static thread_local uint32_t countdown = 0;
+    if(countdown != 0 && countdown < period) {
+        --countdown;
+        return false;
+    }
+    countdown = period - 1;
+#endif
+    return true;
+}
+
+template<typename T>
+class CheckedIterator {
+public:
+    using iterator_category = std::random_access_iterator_tag;
+#ifdef __cpp_lib_concepts
+    using iterator_concept = std::contiguous_iterator_tag;
+#endif
+    using value_type = std::remove_cv_t<T>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = T*;
+    using reference = T&;
+
+    CheckedIterator() = default;
+
+    // `owner` is the generation counter of the vector, or nullptr for an
+    // iterator that is not tracked.
+    ADVANCED_VECTOR_CONSTEXPR CheckedIterator(T* ptr, T* first, T* last, const uint64_t* owner) noexcept
+    : ptr_(ptr)
+    , first_(first)
+    , last_(last)
+    , owner_(owner)
+    , generation_(owner != nullptr ? *owner : 0) {
+    }
+
+    template<typename U, typename = std::enable_if_t<std::is_same_v<const U, T> && !std::is_same_v<U, T>>>
+    ADVANCED_VECTOR_CONSTEXPR CheckedIterator(const CheckedIterator<U>& other) noexcept
+    : ptr_(other.ptr_)
+    , first_(other.first_)
+    , last_(other.last_)
+    , owner_(other.owner_)
+    , generation_(other.generation_) {
+    }
+
+    // The plain pointer, without any check.
+    [[nodiscard]] ADVANCED_VECTOR_CONSTEXPR T* Base() const noexcept {
+        return ptr_;
+    }
+
+    // Whether the iterator may still be used with the vector whose
+    // generation counter is `owner`, one past the end included.
+    [[nodiscard]] ADVANCED_VECTOR_CONSTEXPR bool IsValidFor(const uint64_t* owner) const noexcept {
+        return owner_ == nullptr || (owner_ == owner && *owner_ == generation_ && ptr_ >= first_ && ptr_ <= last_);
+    }
+
+    ADVANCED_VECTOR_CONSTEXPR T& operator*() const noexcept {
+        CheckDereferenceable(ptr_);
+        return *ptr_;
+    }
+
+    ADVANCED_VECTOR_CONSTEXPR T* operator->() const noexcept {
+        CheckDereferenceable(ptr_);
+        return ptr_;
+    }
+
+    ADVANCED_VECTOR_CONSTEXPR T& operator[](const difference_type offset) const noexcept {
+        CheckDereferenceable(ptr_ + offset);
+        return ptr_[offset];
+    }
+
+    ADVANCED_VECTOR_CONSTEXPR CheckedIterator& operator++() noexcept {
+        ++ptr_;
+        return *this;
+    }
+
+    ADVANCED_VECTOR_CONSTEXPR CheckedIterator operator++(int) noexcept {
+        CheckedIterator old = *this;
+        ++ptr_;
+        return old;
+    }
+
+    ADVANCED_VECTOR_CONSTEXPR CheckedIterator& operator--() noexcept {
+        --ptr_;
+        return *this;
+    }
+
+    ADVANCED_VECTOR_CONSTEXPR CheckedIterator operator--(int) noexcept {
+        CheckedIterator old = *this;
+        --ptr_;
+        return old;
+    }
+
+    ADVANCED_VECTOR_CONSTEXPR CheckedIterator& operator+=(const difference_type offset) noexcept {
+        ptr_ += offset;
+        return *this;
+    }
+
+    ADVANCED_VECTOR_CONSTEXPR CheckedIterator& operator-=(const difference_type offset) noexcept {
+        ptr_ -= offset;
+        return *this;
+    }
+
+    friend ADVANCED_VECTOR_CONSTEXPR CheckedIterator operator+(CheckedIterator it,
+                                                               const difference_type offset) noexcept {
+        return it += offset;
+    }
+
+    friend ADVANCED_VECTOR_CONSTEXPR CheckedIterator operator+(const difference_type offset,
+                                                               CheckedIterator it) noexcept {
+        return it += offset;
+    }
+
+    friend ADVANCED_VECTOR_CONSTEXPR CheckedIterator operator-(CheckedIterator it,
+                                                               const difference_type offset) noexcept {
+        return it -= offset;
+    }
+
+    friend ADVANCED_VECTOR_CONSTEXPR difference_type operator-(const CheckedIterator& lhs,
+                                                               const CheckedIterator& rhs) noexcept {
+        return lhs.ptr_ - rhs.ptr_;
+    }
+
+    friend ADVANCED_VECTOR_CONSTEXPR bool operator==(const CheckedIterator& lhs, const CheckedIterator& rhs) noexcept {
+        return lhs.ptr_ == rhs.ptr_;
+    }
+
+    friend ADVANCED_VECTOR_CONSTEXPR bool operator!=(const CheckedIterator& lhs, const CheckedIterator& rhs) noexcept {
+        return lhs.ptr_ != rhs.ptr_;
+    }
+
+    friend ADVANCED_VECTOR_CONSTEXPR bool operator<(const CheckedIterator& lhs, const CheckedIterator& rhs) noexcept {
+        return lhs.ptr_ < rhs.ptr_;
+    }
+
+    friend ADVANCED_VECTOR_CONSTEXPR bool operator>(const CheckedIterator& lhs, const CheckedIterator& rhs) noexcept {
+        return lhs.ptr_ > rhs.ptr_;
+    }
+
+    friend ADVANCED_VECTOR_CONSTEXPR bool operator<=(const CheckedIterator& lhs, const CheckedIterator& rhs) noexcept {
+        return lhs.ptr_ <= rhs.ptr_;
+    }
+
+    friend ADVANCED_VECTOR_CONSTEXPR bool operator>=(const CheckedIterator& lhs, const CheckedIterator& rhs) noexcept {
+        return lhs.ptr_ >= rhs.ptr_;
+    }
+
+private:
+    template<typename U>
+    friend class CheckedIterator;
+
+    T* ptr_ = nullptr;
+    T* first_ = nullptr;
+    T* last_ = nullptr;
+    const uint64_t* owner_ = nullptr;
+    uint64_t generation_ = 0;
+
+    ADVANCED_VECTOR_CONSTEXPR void CheckDereferenceable(const T* ptr) const noexcept {
+        if(owner_ == nullptr) {
+            return;
+        }
+        Check(*owner_ == generation_, "iterator used after the vector was reallocated or modified");
+        Check(ptr >= first_ && ptr < last_, "iterator dereferenced out of range");
+    }
+};
+
+// Generation counter of a Vector in the hardened modes.
+class CheckedGeneration {
+public:
+    ADVANCED_VECTOR_CONSTEXPR void Bump() noexcept {
+        ++value_;
+    }
+
+    template<typename T>
+    [[nodiscard]] ADVANCED_VECTOR_CONSTEXPR CheckedIterator<T> MakeIterator(T* ptr, T* first,
+                                                                             T* last) const noexcept {
+        if(IsConstantEvaluated()) {
+            return CheckedIterator<T>(ptr, first, last, nullptr);
+        }
+        return CheckedIterator<T>(ptr, first, last, Sample() ? &value_ : nullptr);
+    }
+
+    template<typename T>
+    ADVANCED_VECTOR_CONSTEXPR void CheckIterator(const CheckedIterator<T>& it) const noexcept {
+        Check(it.IsValidFor(&value_), "iterator does not belong to this vector or is stale");
+    }
+
+private:
+    uint64_t value_ = 0;
+};
+
+struct UncheckedGeneration {
+    constexpr void Bump() noexcept {
+    }
+
+    template<typename T>
+    [[nodiscard]] constexpr T* MakeIterator(T* ptr, T* /*first*/, T* /*last*/) const noexcept {
+        return ptr;
+    }
+
+    template<typename T>
+    constexpr void CheckIterator(T* /*it*/) const noexcept {
+    }
+};
+
+#ifdef ADVANCED_VECTOR_CHECKED
+template<typename T>
+using Iterator = CheckedIterator<T>;
+using Generation = CheckedGeneration;
+#else
+template<typename T>
+using Iterator = T*;
+using Generation = UncheckedGeneration;
+#endif
+
+}  // namespace detail::hardening
+
+#ifdef __cpp_lib_concepts
+// Lets std::to_address reach the element without the dereference check, so
+// that end() converts too and Vector stays a contiguous range.
+template<typename T>
+struct std::pointer_traits<detail::hardening::CheckedIterator<T>> {
+    using pointer = detail::hardening::CheckedIterator<T>;
+    using element_type = T;
+    using difference_type = std::ptrdiff_t;
+
+    static constexpr T* to_address(const pointer& it) noexcept {
+        return it.Base();
+    }
+};
+#endif
+
+inline void SetHardeningHandler(const HardeningHandler handler) noexcept {
+    detail::hardening::handler.store(handler != nullptr ? handler : &detail::hardening::AbortHandler,
+                                     std::memory_order_release);
+}
+
+// With ADVANCED_VECTOR_HARDENED_SAMPLED one iterator in `period` is tracked
+// on each thread; 0 turns tracking off. Ignored by the other modes.
+inline void SetHardeningSamplePeriod(const uint32_t period) noexcept {
+    detail::hardening::sample_period.store(period, std::memory_order_relaxed);
+}
+
+[[nodiscard]] inline uint32_t GetHardeningSamplePeriod() noexcept {
+    return detail::hardening::sample_period.load(std::memory_order_relaxed);
+}
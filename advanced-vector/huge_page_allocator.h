@@ -0,0 +1,215 @@
+#pragma once
+
+#include "vector.h"
+
+#if !defined(__linux__)
+#error "huge_page_allocator.h relies on Linux mmap/mremap/mbind"
+#endif
+
+#include <cerrno>
+#include <system_error>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+struct HugePageOptions {
+    enum class PageSize {
+        // Ordinary pages.
+        NORMAL,
+        // Ordinary pages advised with MADV_HUGEPAGE.
+        TRANSPARENT,
+        // Pages from the hugetlbfs pool, falling back to TRANSPARENT when the
+        // pool is exhausted.
+        HUGE_2MB,
+        HUGE_1GB,
+    };
+
+    enum class NumaPolicy {
+        // Pages land on the node of the thread that first touches them; pair
+        // it with the ParallelPolicy constructors to spread the buffer.
+        FIRST_TOUCH,
+        BIND,
+        INTERLEAVE,
+    };
+
+    // Buffers smaller than this come from operator new.
+    size_t threshold = size_t{2} << 20;
+    PageSize page_size = PageSize::TRANSPARENT;
+    NumaPolicy numa = NumaPolicy::FIRST_TOUCH;
+    // Bit i selects NUMA node i for BIND and INTERLEAVE.
+    unsigned long node_mask = 0;
+
+    bool operator==(const HugePageOptions& other) const noexcept {
+        return threshold == other.threshold && page_size == other.page_size
+               && numa == other.numa && node_mask == other.node_mask;
+    }
+
+    bool operator!=(const HugePageOptions& other) const noexcept {
+        return !(*this == other);
+    }
+};
+
+namespace detail {
+
+// Kernel ABI values from <linux/mempolicy.h> and <linux/mman.h>, so that
+// neither libnuma nor recent kernel headers are needed.
+inline constexpr int MPOL_BIND_MODE = 2;
+inline constexpr int MPOL_INTERLEAVE_MODE = 3;
+inline constexpr int MAP_HUGE_SHIFT_BITS = 26;
+
+inline void* MapHugePages(const size_t bytes, const HugePageOptions& options) noexcept {
+    const int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    void* ptr = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    if(options.page_size == HugePageOptions::PageSize::HUGE_2MB
+       || options.page_size == HugePageOptions::PageSize::HUGE_1GB) {
+        const int log2_size = options.page_size == HugePageOptions::PageSize::HUGE_2MB ? 21 : 30;
+        ptr = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                     flags | MAP_HUGETLB | (log2_size << MAP_HUGE_SHIFT_BITS), -1, 0);
+    }
+#endif
+    if(ptr == MAP_FAILED) {
+        ptr = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, flags, -1, 0);
+#ifdef MADV_HUGEPAGE
+        if(ptr != MAP_FAILED && options.page_size != HugePageOptions::PageSize::NORMAL) {
+            ::madvise(ptr, bytes, MADV_HUGEPAGE);
+        }
+#endif
+    }
+    return ptr;
+}
+
+inline bool BindToNodes(void* ptr, const size_t bytes, const HugePageOptions& options) noexcept {
+    if(options.numa == HugePageOptions::NumaPolicy::FIRST_TOUCH) {
+        return true;
+    }
+    const int mode = options.numa == HugePageOptions::NumaPolicy::BIND ? MPOL_BIND_MODE : MPOL_INTERLEAVE_MODE;
+    const unsigned long max_node = sizeof(options.node_mask) * CHAR_BIT;
+    return ::syscall(SYS_mbind, ptr, bytes, mode, &options.node_mask, max_node, 0) == 0;
+}
+
+}  // namespace detail
+
+// Allocator that maps buffers of at least options.threshold bytes directly,
+// on huge pages and with the requested NUMA placement, and grows them with
+// mremap. The options travel with the allocator, so they can be chosen per
+// Vector instance.
+template<typename T>
+class HugePageAllocator {
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    HugePageAllocator() = default;
+
+    explicit HugePageAllocator(const HugePageOptions& options) noexcept
+    : options_(options) {
+    }
+
+    template<typename U>
+    HugePageAllocator(const HugePageAllocator<U>& other) noexcept
+    : options_(other.GetOptions()) {
+    }
+
+    [[nodiscard]] const HugePageOptions& GetOptions() const noexcept {
+        return options_;
+    }
+
+    T* allocate(const size_t count) {
+        if(count > (SIZE_MAX - PageBytes()) / sizeof(T)) {
+            ADVANCED_VECTOR_THROW(std::bad_array_new_length());
+        }
+        if(!IsMapped(count)) {
+            return static_cast<T*>(operator new(count * sizeof(T)));
+        }
+        const size_t bytes = MappedBytes(count);
+        void* ptr = detail::MapHugePages(bytes, options_);
+        if(ptr == MAP_FAILED) {
+            ADVANCED_VECTOR_THROW(std::bad_alloc());
+        }
+        if(!detail::BindToNodes(ptr, bytes, options_)) {
+            [[maybe_unused]] const int error = errno;
+            ::munmap(ptr, bytes);
+            ADVANCED_VECTOR_THROW(std::system_error(error, std::generic_category(), "mbind"));
+        }
+        return static_cast<T*>(ptr);
+    }
+
+    void deallocate(T* ptr, const size_t count) noexcept {
+        if(IsMapped(count)) {
+            ::munmap(ptr, MappedBytes(count));
+        } else {
+            operator delete(ptr);
+        }
+    }
+
+    // Only mapped blocks on ordinary or transparent huge pages are remapped;
+    // everything else returns nullptr and is reallocated by copying.
+    T* reallocate(T* ptr, const size_t old_count, const size_t new_count) noexcept {
+        if(!IsMapped(old_count) || !IsMapped(new_count) || IsHugeTlb()
+           || new_count > (SIZE_MAX - PageBytes()) / sizeof(T)) {
+            return nullptr;
+        }
+        const size_t old_bytes = MappedBytes(old_count);
+        const size_t new_bytes = MappedBytes(new_count);
+        void* new_ptr = ::mremap(ptr, old_bytes, new_bytes, MREMAP_MAYMOVE);
+        if(new_ptr == MAP_FAILED) {
+            return nullptr;
+        }
+#ifdef MADV_HUGEPAGE
+        if(options_.page_size != HugePageOptions::PageSize::NORMAL) {
+            ::madvise(new_ptr, new_bytes, MADV_HUGEPAGE);
+        }
+#endif
+        return static_cast<T*>(new_ptr);
+    }
+
+    template<typename U>
+    bool operator==(const HugePageAllocator<U>& other) const noexcept {
+        return options_ == other.GetOptions();
+    }
+
+    template<typename U>
+    bool operator!=(const HugePageAllocator<U>& other) const noexcept {
+        return !(*this == other);
+    }
+
+private:
+    static constexpr size_t BASE_PAGE_SIZE = 4096;
+
+    HugePageOptions options_;
+
+    bool IsMapped(const size_t count) const noexcept {
+        return count * sizeof(T) >= options_.threshold;
+    }
+
+    bool IsHugeTlb() const noexcept {
+        return options_.page_size == HugePageOptions::PageSize::HUGE_2MB
+               || options_.page_size == HugePageOptions::PageSize::HUGE_1GB;
+    }
+
+    size_t PageBytes() const noexcept {
+        switch(options_.page_size) {
+        case HugePageOptions::PageSize::HUGE_2MB:
+            return size_t{1} << 21;
+        case HugePageOptions::PageSize::HUGE_1GB:
+            return size_t{1} << 30;
+        default:
+            return BASE_PAGE_SIZE;
+        }
+    }
+
+    // Huge page mappings must span whole huge pages; the fallback mapping
+    // uses the same length so deallocate does not need to know which of the
+    // two was taken.
+    size_t MappedBytes(const size_t count) const noexcept {
+        const size_t page = PageBytes();
+        return (count * sizeof(T) + page - 1) / page * page;
+    }
+};
+
+template<typename T, typename GrowthPolicy = DoublingGrowthPolicy>
+using HugePageVector = Vector<T, HugePageAllocator<T>, GrowthPolicy>;
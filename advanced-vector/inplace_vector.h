@@ -0,0 +1,272 @@
+#pragma once
+
+#include "vector.h"
+
+namespace detail {
+
+// Inline buffer and size of InplaceVector. With trivially copyable T the
+// specialization below keeps the implicit copy, move and destructor, so the
+// vector is trivially copyable as well and copies as a single memcpy.
+template<typename T, size_t N, bool = std::is_trivially_copyable_v<T>>
+class InplaceStorage {
+public:
+    InplaceStorage() noexcept {
+    }
+
+    InplaceStorage(const InplaceStorage& other) {
+        UninitializedCopyN(other.Data(), other.size_, Data());
+        size_ = other.size_;
+    }
+
+    InplaceStorage(InplaceStorage&& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+        RelocateN(other.Data(), other.size_, Data());
+        size_ = std::exchange(other.size_, 0);
+    }
+
+    ~InplaceStorage() {
+        std::destroy_n(Data(), size_);
+    }
+
+    InplaceStorage& operator=(const InplaceStorage& other) {
+        if(this != &other) {
+            AssignN(other.Data(), other.size_);
+        }
+        return *this;
+    }
+
+    InplaceStorage& operator=(InplaceStorage&& other) noexcept(std::is_nothrow_move_constructible_v<T>
+                                                               && std::is_nothrow_move_assignable_v<T>) {
+        if(this != &other) {
+            AssignN(std::make_move_iterator(other.Data()), other.size_);
+            std::destroy_n(other.Data(), other.size_);
+            other.size_ = 0;
+        }
+        return *this;
+    }
+
+    T* Data() noexcept {
+        return reinterpret_cast<T*>(storage_);
+    }
+
+    const T* Data() const noexcept {
+        return reinterpret_cast<const T*>(storage_);
+    }
+
+protected:
+    alignas(T) unsigned char storage_[N * sizeof(T)];
+    size_t size_ = 0;
+
+private:
+    template<typename InputIt>
+    void AssignN(InputIt first, const size_t count) {
+        if(size_ < count) {
+            std::copy_n(first, size_, Data());
+            UninitializedCopyN(std::next(first, size_), count - size_, Data() + size_);
+        } else {
+            std::copy_n(first, count, Data());
+            std::destroy_n(Data() + count, size_ - count);
+        }
+        size_ = count;
+    }
+};
+
+template<typename T, size_t N>
+class InplaceStorage<T, N, true> {
+public:
+    T* Data() noexcept {
+        return reinterpret_cast<T*>(storage_);
+    }
+
+    const T* Data() const noexcept {
+        return reinterpret_cast<const T*>(storage_);
+    }
+
+protected:
+    alignas(T) unsigned char storage_[N * sizeof(T)];
+    size_t size_ = 0;
+};
+
+}  // namespace detail
+
+// Vector with a fixed capacity of N elements stored inline; it never
+// allocates. The throwing members report a full vector with std::bad_alloc,
+// the Try* members with VectorStatus::CAPACITY_EXCEEDED.
+template<typename T, size_t N>
+class InplaceVector : private detail::InplaceStorage<T, N> {
+    using Storage = detail::InplaceStorage<T, N>;
+    using Storage::size_;
+
+public:
+    static_assert(N > 0, "InplaceVector needs room for at least one element");
+
+    using value_type = T;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    using Storage::Data;
+
+    InplaceVector() = default;
+
+    explicit InplaceVector(const size_t count) {
+        Resize(count);
+    }
+
+    InplaceVector(std::initializer_list<T> init) {
+        if(init.size() > N) {
+            ThrowFull();
+        }
+        detail::UninitializedCopyN(init.begin(), init.size(), Data());
+        size_ = init.size();
+    }
+
+    iterator begin() noexcept {
+        return Data();
+    }
+
+    const_iterator cbegin() const noexcept {
+        return Data();
+    }
+
+    const_iterator begin() const noexcept {
+        return cbegin();
+    }
+
+    iterator end() noexcept {
+        return Data() + size_;
+    }
+
+    const_iterator cend() const noexcept {
+        return Data() + size_;
+    }
+
+    const_iterator end() const noexcept {
+        return cend();
+    }
+
+    [[nodiscard]] static constexpr size_t Capacity() noexcept {
+        return N;
+    }
+
+    [[nodiscard]] size_t Size() const noexcept {
+        return size_;
+    }
+
+    [[nodiscard]] bool Empty() const noexcept {
+        return size_ == 0;
+    }
+
+    [[nodiscard]] bool Full() const noexcept {
+        return size_ == N;
+    }
+
+    void Resize(const size_t new_size) {
+        if(TryResize(new_size) != VectorStatus::OK) {
+            ThrowFull();
+        }
+    }
+
+    VectorStatus TryResize(const size_t new_size) {
+        if(new_size > N) {
+            return VectorStatus::CAPACITY_EXCEEDED;
+        }
+        if(new_size < size_) {
+            std::destroy_n(Data() + new_size, size_ - new_size);
+        } else if(new_size > size_) {
+            detail::UninitializedValueConstructN(Data() + size_, new_size - size_);
+        }
+        size_ = new_size;
+        return VectorStatus::OK;
+    }
+
+    template<typename Type>
+    void PushBack(Type&& elem) {
+        Emplace(cend(), std::forward<Type>(elem));
+    }
+
+    template<typename Type>
+    VectorStatus TryPushBack(Type&& elem) {
+        return TryEmplaceBack(std::forward<Type>(elem));
+    }
+
+    void PopBack() noexcept {
+        assert(size_ > 0);
+        std::destroy_at(Data() + (size_ - 1));
+        --size_;
+    }
+
+    template<typename... Args>
+    iterator Emplace(const_iterator pos, Args&&... args) {
+        if(size_ == N) {
+            ThrowFull();
+        }
+        const size_t position = pos - begin();
+        detail::EmplaceInSpare(Data(), size_, position, std::forward<Args>(args)...);
+        ++size_;
+        return begin() + position;
+    }
+
+    template<typename... Args>
+    T& EmplaceBack(Args&&... args) {
+        return *Emplace(cend(), std::forward<Args>(args)...);
+    }
+
+    template<typename... Args>
+    VectorStatus TryEmplaceBack(Args&&... args) {
+        if(size_ == N) {
+            return VectorStatus::CAPACITY_EXCEEDED;
+        }
+        detail::EmplaceInSpare(Data(), size_, size_, std::forward<Args>(args)...);
+        ++size_;
+        return VectorStatus::OK;
+    }
+
+    iterator Insert(const_iterator pos, const T& elem) {
+        return Emplace(pos, elem);
+    }
+
+    iterator Insert(const_iterator pos, T&& elem) {
+        return Emplace(pos, std::move(elem));
+    }
+
+    iterator Erase(const_iterator pos) {
+        assert(pos < end() && pos >= begin());
+        size_t position = pos - begin();
+        detail::EraseAt(Data(), size_, position);
+        --size_;
+        return begin() + position;
+    }
+
+    iterator EraseUnordered(const_iterator pos) {
+        assert(pos < end() && pos >= begin());
+        size_t position = pos - begin();
+        detail::EraseUnorderedAt(Data(), size_, position);
+        --size_;
+        return begin() + position;
+    }
+
+    void Clear() noexcept {
+        std::destroy_n(Data(), size_);
+        size_ = 0;
+    }
+
+    void Swap(InplaceVector& other) noexcept(std::is_nothrow_move_constructible_v<T>
+                                             && std::is_nothrow_move_assignable_v<T>) {
+        InplaceVector temp(std::move(other));
+        other = std::move(*this);
+        *this = std::move(temp);
+    }
+
+    const T& operator[](const size_t index) const noexcept {
+        return const_cast<InplaceVector&>(*this)[index];
+    }
+
+    T& operator[](const size_t index) noexcept {
+        assert(index < size_);
+        return Data()[index];
+    }
+
+private:
+    [[noreturn]] static void ThrowFull() {
+        ADVANCED_VECTOR_THROW(std::bad_alloc());
+    }
+};
@@ -1,10 +1,39 @@
 #include "vector.h"
+#include "small_vector.h"
+#include "concurrent_vector.h"
+#include "segmented_vector.h"
+#include "buffer_cache.h"
+#include "soa_vector.h"
+#include "inplace_vector.h"
+#include "shared_vector.h"
+#include "vector_profiler.h"
+#ifdef __linux__
+#include "mapped_vector.h"
+#include "huge_page_allocator.h"
+#include "vector_io.h"
+#endif
 
 #include <iostream>
 #include <stdexcept>
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <sstream>
+#include <iterator>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <cmath>
+#include <limits>
+#include <memory_resource>
+
+#if __cplusplus >= 202002L && __has_include(<ranges>)
+#include <ranges>
+#include <span>
+#endif
 
 namespace {
 
@@ -116,8 +145,130 @@ struct Obj {
     static inline int num_move_assigned = 0;
 };
 
+struct RelocatableObj {
+    explicit RelocatableObj(int id)
+        : id(std::make_unique<int>(id))
+    {
+    }
+
+    RelocatableObj(RelocatableObj&& other) noexcept
+        : id(std::move(other.id))
+    {
+        ++num_moved;
+    }
+
+    RelocatableObj& operator=(RelocatableObj&& other) noexcept {
+        id = std::move(other.id);
+        ++num_moved;
+        return *this;
+    }
+
+    std::unique_ptr<int> id;
+
+    static inline int num_moved = 0;
+};
+
+// Obj counterpart with thread-safe counters for the parallel operations.
+struct SharedObj {
+    SharedObj() {
+        if (default_construction_throw_countdown.fetch_sub(1) == 1) {
+            throw std::runtime_error("Oops");
+        }
+        ++num_alive;
+    }
+
+    SharedObj(const SharedObj& other)
+        : id(other.id)
+    {
+        if (other.throw_on_copy) {
+            throw std::runtime_error("Oops");
+        }
+        ++num_alive;
+    }
+
+    SharedObj(SharedObj&& other) noexcept
+        : id(other.id)
+    {
+        ++num_alive;
+    }
+
+    ~SharedObj() {
+        --num_alive;
+    }
+
+    static void ResetCounters() {
+        default_construction_throw_countdown = 0;
+        num_alive = 0;
+    }
+
+    bool throw_on_copy = false;
+    size_t id = 0;
+
+    static inline std::atomic<int> default_construction_throw_countdown = 0;
+    static inline std::atomic<int> num_alive = 0;
+};
+
+template<typename T, bool Propagate>
+struct CountingAllocator {
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::bool_constant<Propagate>;
+    using propagate_on_container_move_assignment = std::bool_constant<Propagate>;
+    using propagate_on_container_swap = std::bool_constant<Propagate>;
+    using is_always_equal = std::false_type;
+
+    template<typename U>
+    struct rebind {
+        using other = CountingAllocator<U, Propagate>;
+    };
+
+    explicit CountingAllocator(int id = 0) noexcept
+        : id(id)
+    {
+    }
+
+    template<typename U>
+    CountingAllocator(const CountingAllocator<U, Propagate>& other) noexcept
+        : id(other.id)
+    {
+    }
+
+    T* allocate(size_t n) {
+        ++num_allocations;
+        return static_cast<T*>(operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t /*n*/) noexcept {
+        ++num_deallocations;
+        operator delete(p);
+    }
+
+    template<typename U>
+    bool operator==(const CountingAllocator<U, Propagate>& other) const noexcept {
+        return id == other.id;
+    }
+
+    template<typename U>
+    bool operator!=(const CountingAllocator<U, Propagate>& other) const noexcept {
+        return id != other.id;
+    }
+
+    static void ResetCounters() {
+        num_allocations = 0;
+        num_deallocations = 0;
+    }
+
+    int id = 0;
+
+    static inline int num_allocations = 0;
+    static inline int num_deallocations = 0;
+};
+
 }  // namespace
 
+template<>
+struct IsTriviallyRelocatable<RelocatableObj> : std::true_type {
+};
+
 void Test1() {
     Obj::ResetCounters();
     const size_t SIZE = 100500;
@@ -423,7 +574,7 @@ void Test6() {
     {
         Obj::ResetCounters();
         Vector<Obj> v;
-        auto* pos = v.Emplace(v.end(), Obj{1});
+        auto pos = v.Emplace(v.end(), Obj{1});
         assert(v.Size() == 1);
         assert(v.Capacity() >= v.Size());
         assert(&*pos == &v[0]);
@@ -438,7 +589,7 @@ void Test6() {
         Obj::ResetCounters();
         Vector<Obj> v;
         v.Reserve(SIZE);
-        auto* pos = v.Emplace(v.end(), Obj{1});
+        auto pos = v.Emplace(v.end(), Obj{1});
         assert(v.Size() == 1);
         assert(v.Capacity() >= v.Size());
         assert(&*pos == &v[0]);
@@ -485,7 +636,7 @@ void Test6() {
     {
         Obj::ResetCounters();
         Vector<Obj> v{SIZE};
-        auto* pos = v.Emplace(v.cbegin() + 1, ID, "Ivan"s);
+        auto pos = v.Emplace(v.cbegin() + 1, ID, "Ivan"s);
         assert(v.Size() == SIZE + 1);
         assert(v.Capacity() == SIZE * 2);
         assert(&*pos == &v[1]);
@@ -501,7 +652,7 @@ void Test6() {
     {
         Obj::ResetCounters();
         Vector<Obj> v{SIZE};
-        auto* pos = v.Emplace(v.cbegin() + v.Size(), ID, "Ivan"s);
+        auto pos = v.Emplace(v.cbegin() + v.Size(), ID, "Ivan"s);
         assert(v.Size() == SIZE + 1);
         assert(v.Capacity() == SIZE * 2);
         assert(&*pos == &v[SIZE]);
@@ -520,7 +671,7 @@ void Test6() {
         v.Reserve(SIZE * 2);
         const int old_num_moved = Obj::num_moved;
         assert(v.Capacity() == SIZE * 2);
-        auto* pos = v.Emplace(v.cbegin() + 3, ID, "Ivan"s);
+        auto pos = v.Emplace(v.cbegin() + 3, ID, "Ivan"s);
         assert(v.Size() == SIZE + 1);
         assert(&*pos == &v[3]);
         assert(v[3].id == ID);
@@ -536,7 +687,7 @@ void Test6() {
         Obj::ResetCounters();
         Vector<Obj> v{SIZE};
         v[2].id = ID;
-        auto* pos = v.Erase(v.cbegin() + 1);
+        auto pos = v.Erase(v.cbegin() + 1);
         assert((pos - v.begin()) == 1);
         assert(v.Size() == SIZE - 1);
         assert(v.Capacity() == SIZE);
@@ -549,85 +700,1858 @@ void Test6() {
     }
 }
 
-struct C {
-    C() noexcept {
-        ++def_ctor;
+void Test7() {
+    const size_t SIZE = 10;
+    const int ID = 42;
+    {
+        using Alloc = CountingAllocator<Obj, false>;
+        Obj::ResetCounters();
+        Alloc::ResetCounters();
+        {
+            Vector<Obj, Alloc> v(SIZE, Alloc{1});
+            v.PushBack(Obj{ID});
+            assert(v.GetAllocator().id == 1);
+            assert(Alloc::num_allocations == 2);
+            assert(Alloc::num_deallocations == 1);
+
+            Vector<Obj, Alloc> v_other(Alloc{2});
+            v_other = std::move(v);
+            assert(v_other.GetAllocator().id == 2);
+            assert(v_other.Size() == SIZE + 1);
+            assert(v_other[SIZE].id == ID);
+
+            Vector<Obj, Alloc> v_same(Alloc{2});
+            v_same = std::move(v_other);
+            assert(v_same.Size() == SIZE + 1);
+            assert(v_other.Size() == 0);
+        }
+        assert(Alloc::num_allocations == Alloc::num_deallocations);
+        assert(Obj::GetAliveObjectCount() == 0);
     }
-    C(const C& /*other*/) noexcept {
-        ++copy_ctor;
+    {
+        using Alloc = CountingAllocator<Obj, true>;
+        Obj::ResetCounters();
+        Alloc::ResetCounters();
+        {
+            Vector<Obj, Alloc> v(SIZE, Alloc{1});
+            Vector<Obj, Alloc> v_copy(SIZE * 2, Alloc{2});
+            v_copy = v;
+            assert(v_copy.GetAllocator().id == 1);
+            assert(v_copy.Size() == SIZE);
+
+            Vector<Obj, Alloc> v_moved(Alloc{3});
+            v_moved = std::move(v_copy);
+            assert(v_moved.GetAllocator().id == 1);
+
+            Vector<Obj, Alloc> v_swapped(Alloc{4});
+            v_swapped.Swap(v_moved);
+            assert(v_swapped.GetAllocator().id == 1);
+            assert(v_moved.GetAllocator().id == 4);
+            assert(v_swapped.Size() == SIZE);
+        }
+        assert(Alloc::num_allocations == Alloc::num_deallocations);
+        assert(Obj::GetAliveObjectCount() == 0);
     }
-    C(C&& /*other*/) noexcept {
-        ++move_ctor;
+}
+
+void Test8() {
+    const size_t SIZE = 10;
+    {
+        RelocatableObj::num_moved = 0;
+        Vector<RelocatableObj> v;
+        for(size_t i = 0; i != SIZE; ++i) {
+            v.EmplaceBack(static_cast<int>(i));
+        }
+        v.Reserve(SIZE * 4);
+        v.Emplace(v.cbegin() + 2, 100);
+        v.Erase(v.cbegin());
+        assert(v.Size() == SIZE);
+        assert(*v[1].id == 100);
+        assert(*v[0].id == 1);
+        assert(*v[SIZE - 1].id == static_cast<int>(SIZE - 1));
+        assert(RelocatableObj::num_moved == 0);
     }
-    C& operator=(const C& other) noexcept {
-        if (this != &other) {
-            ++copy_assign;
+    {
+        Vector<int> v;
+        for(int i = 0; i != static_cast<int>(SIZE); ++i) {
+            v.Insert(v.cbegin(), i);
         }
-        return *this;
+        for(size_t i = 0; i != SIZE; ++i) {
+            assert(v[i] == static_cast<int>(SIZE - 1 - i));
+        }
+        v.Erase(v.cbegin() + 3);
+        assert(v.Size() == SIZE - 1);
+        assert(v[3] == static_cast<int>(SIZE - 5));
     }
-    C& operator=(C&& /*other*/) noexcept {
-        ++move_assign;
-        return *this;
+}
+
+void Test9() {
+    const size_t SIZE = 100'000;
+    {
+        Vector<int, MallocAllocator<int>> v;
+        for(int i = 0; i != static_cast<int>(SIZE); ++i) {
+            v.PushBack(i);
+        }
+        v.Insert(v.cbegin(), -1);
+        assert(v.Size() == SIZE + 1);
+        assert(v[0] == -1);
+        for(size_t i = 1; i != v.Size(); ++i) {
+            assert(v[i] == static_cast<int>(i - 1));
+        }
+        v.Reserve(SIZE * 8);
+        assert(v.Capacity() == SIZE * 8);
+        assert(v[SIZE] == static_cast<int>(SIZE - 1));
     }
-    ~C() {
-        ++dtor;
+    {
+        Vector<int, MallocAllocator<int>> v(1);
+        v[0] = 7;
+        v.PushBack(v[0]);
+        v.PushBack(v[1]);
+        assert(v.Size() == 3);
+        assert(v[2] == 7);
     }
+}
 
-    static void Reset() {
-        def_ctor = 0;
-        copy_ctor = 0;
-        move_ctor = 0;
-        copy_assign = 0;
-        move_assign = 0;
-        dtor = 0;
+void Test10() {
+    static_assert(DoublingGrowthPolicy::NextCapacity(0, 1, 4) == 1);
+    static_assert(DoublingGrowthPolicy::NextCapacity(10, 11, 4) == 20);
+    using Policy = GeometricGrowthPolicy<3, 2, 8, 0, false>;
+    static_assert(Policy::NextCapacity(0, 1, 4) == 8);
+    static_assert(Policy::NextCapacity(8, 9, 4) == 12);
+    static_assert(Policy::NextCapacity(1, 2, 4) == 8);
+    using LinearPolicy = GeometricGrowthPolicy<2, 1, 1, 4096, false>;
+    static_assert(LinearPolicy::NextCapacity(512, 513, 8) == 1024);
+    static_assert(LinearPolicy::NextCapacity(1024, 1025, 4) == 2048);
+    static_assert(LinearPolicy::NextCapacity(2048, 2049, 4) == 3072);
+    using RoundedPolicy = GeometricGrowthPolicy<3, 2, 1, 0, true>;
+    static_assert(RoundedPolicy::NextCapacity(0, 1, 4) == 4);
+    static_assert(RoundedPolicy::NextCapacity(40, 41, 4) == 64);
+    static_assert(RoundedPolicy::NextCapacity(2000, 2001, 4) == 3072);
+
+    const size_t SIZE = 1000;
+    {
+        Obj::ResetCounters();
+        Vector<Obj, std::allocator<Obj>, GeometricGrowthPolicy<>> v;
+        v.EmplaceBack(0);
+        assert(v.Capacity() >= 8);
+        for(size_t i = 1; i != SIZE; ++i) {
+            v.EmplaceBack(static_cast<int>(i));
+        }
+        assert(v.Size() == SIZE);
+        assert(v.Capacity() < SIZE * 2);
+        for(size_t i = 0; i != SIZE; ++i) {
+            assert(v[i].id == static_cast<int>(i));
+        }
     }
+    assert(Obj::GetAliveObjectCount() == 0);
+}
 
-    inline static size_t def_ctor = 0;
-    inline static size_t copy_ctor = 0;
-    inline static size_t move_ctor = 0;
-    inline static size_t copy_assign = 0;
-    inline static size_t move_assign = 0;
-    inline static size_t dtor = 0;
-};
+void Test11() {
+    const size_t SMALL = 4;
+    const size_t SIZE = 100;
+    const int ID = 42;
+    using namespace std::literals;
+    {
+        Obj::ResetCounters();
+        SmallVector<Obj, SMALL> v;
+        assert(v.Capacity() == SMALL);
+        assert(v.IsInline());
+        for(size_t i = 0; i != SMALL; ++i) {
+            v.EmplaceBack(static_cast<int>(i));
+        }
+        assert(v.IsInline());
+        v.Insert(v.cbegin() + 1, Obj{ID});
+        assert(!v.IsInline());
+        assert(v.Size() == SMALL + 1);
+        assert(v.Capacity() == SMALL * 2);
+        assert(v[1].id == ID);
+        assert(v[SMALL].id == static_cast<int>(SMALL - 1));
+        v.Erase(v.cbegin());
+        assert(v[0].id == ID);
+        auto& elem = v.EmplaceBack(ID, "Ivan"s);
+        assert(&elem == &v[v.Size() - 1]);
+        assert(elem.name == "Ivan"s);
+        v.Resize(1);
+        assert(v.Size() == 1);
+        v.PopBack();
+        assert(Obj::GetAliveObjectCount() == 0);
+    }
+    {
+        Obj::ResetCounters();
+        Obj::default_construction_throw_countdown = SIZE / 2;
+        try {
+            SmallVector<Obj, SMALL> v(SIZE);
+            assert(false && "Exception is expected");
+        } catch (const std::runtime_error&) {
+        }
+        assert(Obj::GetAliveObjectCount() == 0);
+    }
+    {
+        Obj::ResetCounters();
+        SmallVector<Obj, SMALL> v(SIZE);
+        try {
+            v[SIZE / 2].throw_on_copy = true;
+            SmallVector<Obj, SMALL> v_copy(v);
+            assert(false && "Exception is expected");
+        } catch (const std::runtime_error&) {
+            assert(Obj::num_copied == SIZE / 2);
+        }
+        assert(Obj::GetAliveObjectCount() == SIZE);
+    }
+    {
+        Obj::ResetCounters();
+        SmallVector<Obj, SMALL> v_small(SMALL - 1);
+        v_small[0].id = ID;
+        SmallVector<Obj, SMALL> v_large(SIZE);
+        v_large[SIZE - 1].id = ID;
+
+        SmallVector<Obj, SMALL> v_moved(std::move(v_small));
+        assert(v_moved.IsInline());
+        assert(v_moved[0].id == ID);
+        assert(v_small.Size() == 0);
+
+        SmallVector<Obj, SMALL> v_stolen(std::move(v_large));
+        assert(!v_stolen.IsInline());
+        assert(v_stolen[SIZE - 1].id == ID);
+        assert(Obj::num_moved == static_cast<int>(SMALL - 1));
+
+        v_moved.Swap(v_stolen);
+        assert(v_moved.Size() == SIZE);
+        assert(v_stolen.Size() == SMALL - 1);
+        assert(v_stolen[0].id == ID);
 
-void Dump() {
-    using namespace std;
-    cerr << "Def ctors: "sv << C::def_ctor
-         << ", Copy ctors: "sv << C::copy_ctor
-         << ", Move ctors: "sv << C::move_ctor
-         << ", Copy assignments: "sv << C::copy_assign
-         << ", Move assignments: "sv << C::move_assign
-         << ", Dtors: "sv << C::dtor << endl;
+        SmallVector<Obj, SMALL> v_copy;
+        v_copy = v_moved;
+        assert(v_copy.Size() == SIZE);
+        v_copy = v_stolen;
+        assert(v_copy.Size() == SMALL - 1);
+        assert(v_copy[0].id == ID);
+        assert(Obj::GetAliveObjectCount() == SIZE + 2 * (SMALL - 1));
+    }
+    assert(Obj::GetAliveObjectCount() == 0);
+    {
+        SmallVector<TestObj, SMALL> v(SMALL);
+        v.PushBack(v[0]);
+        v.Insert(v.cbegin() + 2, std::move(v[0]));
+        assert(std::all_of(v.begin(), v.end(), [](const TestObj& obj) {
+            return obj.IsAlive();
+        }));
+    }
 }
 
-void Benchmark() {
-    using namespace std;
-    try {
-        const size_t NUM = 10;
-        C c;
+void Test12() {
+    const size_t SIZE = 10;
+    const int ID = 42;
+    {
+        const std::vector<int> src{1, 2, 3, 4, 5};
+        Vector<int> v(src.begin(), src.end());
+        assert(v.Size() == src.size());
+        assert(v.Capacity() == src.size());
+        assert(std::equal(v.begin(), v.end(), src.begin()));
+
+        v.Insert(v.cbegin() + 1, src.begin(), src.end());
+        const std::vector<int> expected{1, 1, 2, 3, 4, 5, 2, 3, 4, 5};
+        assert(std::equal(v.begin(), v.end(), expected.begin(), expected.end()));
+
+        v.Reserve(100);
+        auto it = v.Insert(v.cbegin() + 2, 3, 0);
+        assert(it == v.begin() + 2);
+        assert(v.Size() == expected.size() + 3);
+        assert(v[1] == 1 && v[2] == 0 && v[4] == 0 && v[5] == 2);
+
+        v.Append(src);
+        assert(v.Size() == expected.size() + 3 + src.size());
+        assert(v[v.Size() - 1] == 5);
+    }
+    {
+        Obj::ResetCounters();
+        Vector<Obj> v(SIZE);
+        std::vector<Obj> src(SIZE / 2);
+        v.Reserve(SIZE * 4);
+        const int old_moves = Obj::num_moved;
+        v.Insert(v.cbegin() + 1, src.begin(), src.end());
+        assert(v.Size() == SIZE + SIZE / 2);
+        assert(Obj::num_copied == 0);
+        assert(Obj::num_assigned == static_cast<int>(SIZE / 2));
+        assert(Obj::num_moved == old_moves + static_cast<int>(SIZE / 2));
+        assert(Obj::num_move_assigned == static_cast<int>(SIZE - 1 - SIZE / 2));
+        v.Insert(v.cbegin() + 2, SIZE * 2, Obj{ID});
+        assert(v.Capacity() == SIZE * 4);
+        assert(v[2].id == ID && v[SIZE * 2 + 1].id == ID);
+        assert(v[SIZE * 2 + 2].id == 0);
+        v.Insert(v.cbegin(), SIZE * 2, Obj{ID});
+        assert(v.Size() == SIZE * 5 + SIZE / 2);
+        assert(v[0].id == ID && v[SIZE * 2].id == 0);
+        assert(Obj::GetAliveObjectCount() == static_cast<int>(v.Size() + src.size()));
+
+        std::vector<Obj> tail(SIZE);
+        v.Append(std::move(tail));
+        assert(v.Size() == SIZE * 6 + SIZE / 2);
+    }
+    assert(Obj::GetAliveObjectCount() == 0);
+    {
+        Obj::ResetCounters();
+        Vector<Obj> v(SIZE);
+        std::vector<Obj> src(SIZE);
+        src[SIZE / 2].throw_on_copy = true;
+        try {
+            v.Insert(v.cbegin() + 1, src.begin(), src.end());
+            assert(false && "Exception is expected");
+        } catch (const std::runtime_error&) {
+        }
+        assert(v.Size() == SIZE);
+        assert(v.Capacity() == SIZE);
+        assert(Obj::GetAliveObjectCount() == static_cast<int>(SIZE * 2));
+    }
+    {
+        std::istringstream input("1 2 3");
+        Vector<int> v(std::istream_iterator<int>{input}, std::istream_iterator<int>{});
+        assert(v.Size() == 3);
+        std::istringstream more("7 8");
+        v.Insert(v.cbegin() + 1, std::istream_iterator<int>{more}, std::istream_iterator<int>{});
+        const std::vector<int> expected{1, 7, 8, 2, 3};
+        assert(std::equal(v.begin(), v.end(), expected.begin(), expected.end()));
+    }
+    {
+        Vector<TestObj> v(SIZE);
+        v.Reserve(SIZE * 2);
+        v.Insert(v.cbegin() + 1, 3, v[SIZE - 1]);
+        v.Insert(v.cbegin(), SIZE * 2, v[0]);
+        assert(std::all_of(v.begin(), v.end(), [](const TestObj& obj) {
+            return obj.IsAlive();
+        }));
+    }
+}
+
+void Test13() {
+    const size_t SIZE = 1000;
+    {
+        Vector<int> v(SIZE);
+        v.Resize(SIZE / 2);
+        v.Resize(SIZE);
+        assert(v[SIZE - 1] == 0);
+        v.ResizeDefaultInit(SIZE * 2);
+        assert(v.Size() == SIZE * 2);
+        assert(v.Capacity() == SIZE * 2);
+        v.ResizeDefaultInit(1);
+        assert(v.Size() == 1);
+    }
+    {
+        Obj::ResetCounters();
+        Vector<Obj> v(SIZE, DEFAULT_INIT);
+        assert(v.Size() == SIZE);
+        assert(Obj::num_default_constructed == SIZE);
+        v.ResizeDefaultInit(SIZE * 2);
+        assert(Obj::num_default_constructed == SIZE * 2);
+    }
+    assert(Obj::GetAliveObjectCount() == 0);
+    {
+        Vector<char> v(3);
+        v[0] = 'a';
+        v.ResizeForOverwrite(SIZE, [](char* data, size_t count) {
+            assert(data[0] == 'a');
+            std::fill_n(data + 1, count - 1, 'b');
+            return count / 2;
+        });
+        assert(v.Size() == SIZE / 2);
+        assert(v.Capacity() >= SIZE);
+        assert(v[0] == 'a');
+        assert(v[SIZE / 2 - 1] == 'b');
+    }
+}
+
+void Test14() {
+    const size_t SIZE = 1000;
+    {
+        Obj::ResetCounters();
+        Vector<Obj> v(SIZE);
+        v.Resize(SIZE / 10);
+        assert(v.Capacity() == SIZE);
+        v.ShrinkToFit();
+        assert(v.Capacity() == SIZE / 10);
+        assert(v.Size() == SIZE / 10);
+        assert(Obj::num_moved == static_cast<int>(SIZE / 10));
+        v.Resize(0);
+        v.ShrinkToFit();
+        assert(v.Capacity() == 0);
+    }
+    assert(Obj::GetAliveObjectCount() == 0);
+    {
+        using Policy = ShrinkingGrowthPolicy<DoublingGrowthPolicy, 4, 16>;
+        static_assert(Policy::NextCapacity(8, 9, 4) == 16);
+        static_assert(Policy::ShrinkCapacity(63, 256, 4) == 126);
+        static_assert(Policy::ShrinkCapacity(64, 256, 4) == 256);
+        static_assert(Policy::ShrinkCapacity(1, 16, 4) == 16);
+
+        Vector<int, std::allocator<int>, Policy> v;
+        for(int i = 0; i != static_cast<int>(SIZE); ++i) {
+            v.PushBack(i);
+        }
+        assert(v.Capacity() == 1024);
+        while(v.Size() > 256) {
+            v.PopBack();
+        }
+        assert(v.Capacity() == 1024);
+        v.PopBack();
+        assert(v.Size() == 255);
+        assert(v.Capacity() == 510);
+        for(size_t i = 0; i != 10; ++i) {
+            v.PushBack(0);
+            v.PopBack();
+        }
+        assert(v.Capacity() == 510);
+        v.Erase(v.cbegin());
+        assert(v[0] == 1);
+        v.Resize(3);
+        assert(v.Capacity() == 16);
+        assert(v[2] == 3);
+    }
+}
+
+void Test15() {
+    const size_t SIZE = 1000;
+    const auto is_aligned = [](const void* ptr, size_t alignment) {
+        return reinterpret_cast<std::uintptr_t>(ptr) % alignment == 0;
+    };
+    {
+        AlignedVector<float> v;
+        for(size_t i = 0; i != SIZE; ++i) {
+            v.PushBack(static_cast<float>(i));
+            assert(is_aligned(v.Data(), CACHE_LINE_SIZE));
+        }
+        v.Insert(v.cbegin() + 1, 0.5f);
+        assert(v[1] == 0.5f);
+        assert(v[SIZE] == static_cast<float>(SIZE - 1));
+    }
+    {
+        Obj::ResetCounters();
         {
-            cerr << "std::vector:"sv << endl;
-            C::Reset();
-            vector<C> v(NUM);
-            Dump();
-            v.push_back(c);
+            PaddedVector<Obj, 128> v(3);
+            assert(is_aligned(v.Data(), 128));
+            v.EmplaceBack(1);
+            v.Reserve(SIZE);
+            assert(is_aligned(v.Data(), 128));
+            assert(v[3].id == 1);
+            PaddedVector<Obj, 128> v_copy(v);
+            assert(is_aligned(v_copy.Data(), 128));
         }
-        Dump();
-    } catch (...) {
+        assert(Obj::GetAliveObjectCount() == 0);
     }
-    try {
-        const size_t NUM = 10;
-        C c;
+}
+
+Vector<VectorEvent> recorded_events;
+
+void RecordEvent(const VectorEvent& event) noexcept {
+    recorded_events.PushBack(event);
+}
+
+void Test16() {
+    const size_t SIZE = 8;
+#ifndef ADVANCED_VECTOR_CHECKED
+    static_assert(sizeof(Vector<int>) == sizeof(RawMemory<int>) + sizeof(size_t));
+#endif
+    {
+        Vector<int, std::allocator<int>, DoublingGrowthPolicy, VectorStats> v;
+        for(int i = 0; i != static_cast<int>(SIZE); ++i) {
+            v.PushBack(i);
+        }
+        const VectorStats& stats = v.GetInstrumentation();
+        assert(stats.reallocations == 4);
+        assert(stats.bytes_allocated == (1 + 2 + 4 + 8) * sizeof(int));
+        assert(stats.elements_relocated == 1 + 2 + 4);
+        assert(stats.peak_capacity == SIZE);
+        assert(stats.wasted_bytes_at_release == 0);
+        v.Reserve(SIZE * 4);
+        assert(stats.wasted_bytes_at_release == 0);
+        assert(stats.elements_relocated == 1 + 2 + 4 + SIZE);
+        auto v_moved(std::move(v));
+        assert(v_moved.GetInstrumentation().peak_capacity == SIZE * 4);
+        v_moved.Resize(1);
+        v_moved.ShrinkToFit();
+        assert(v_moved.GetInstrumentation().wasted_bytes_at_release == (SIZE * 4 - 1) * sizeof(int));
+    }
+    {
+        // Buffers that change hands are neither allocated nor released.
+        using StatsVector = Vector<int, std::allocator<int>, DoublingGrowthPolicy, VectorStats>;
+        StatsVector a;
+        a.Reserve(100);
+        StatsVector b;
+        b.Reserve(10);
+        for(int i = 0; i != 1000; ++i) {
+            a.Swap(b);
+        }
+        for(const VectorStats& stats : {a.GetInstrumentation(), b.GetInstrumentation()}) {
+            assert(stats.reallocations == 1 && stats.wasted_bytes_at_release == 0);
+        }
+        assert(a.GetInstrumentation().bytes_allocated == 100 * sizeof(int));
+        assert(b.GetInstrumentation().bytes_allocated == 10 * sizeof(int));
+        StatsVector c;
+        c.Reserve(SIZE);
+        c = std::move(a);
+        const VectorStats& stats = c.GetInstrumentation();
+        assert(c.Capacity() == 100 && stats.reallocations == 1 && stats.bytes_allocated == SIZE * sizeof(int));
+        assert(stats.wasted_bytes_at_release == SIZE * sizeof(int));
+        assert(a.GetInstrumentation().reallocations == 1 && a.GetInstrumentation().wasted_bytes_at_release == 0);
+    }
+    {
+        // Empty vectors allocate nothing, however they are constructed.
+        using StatsVector = Vector<int, std::allocator<int>, DoublingGrowthPolicy, VectorStats>;
+        const StatsVector counted(0);
+        const StatsVector default_init(0, DEFAULT_INIT);
+        const StatsVector copied(counted);
+        const int* const none = nullptr;
+        const StatsVector ranged(none, none);
+        const StatsVector adopted(ADOPT, nullptr, 0, 0);
+        for(const StatsVector* v : {&counted, &default_init, &copied, &ranged, &adopted}) {
+            assert(v->GetInstrumentation().reallocations == 0 && v->GetInstrumentation().bytes_allocated == 0);
+        }
+    }
+    {
+        CallbackInstrumentation::SetCallback(&RecordEvent);
+        {
+            Vector<int, std::allocator<int>, DoublingGrowthPolicy, CallbackInstrumentation> v(SIZE);
+            v.PushBack(1);
+        }
+        CallbackInstrumentation::SetCallback(nullptr);
+        assert(recorded_events.Size() == 4);
+        assert(recorded_events[0].kind == VectorEvent::Kind::REALLOCATE);
+        assert(recorded_events[0].new_capacity == SIZE);
+        assert(recorded_events[1].kind == VectorEvent::Kind::RELEASE);
+        assert(recorded_events[1].elements == SIZE);
+        assert(recorded_events[2].kind == VectorEvent::Kind::REALLOCATE);
+        assert(recorded_events[2].old_capacity == SIZE);
+        assert(recorded_events[2].new_capacity == SIZE * 2);
+        assert(recorded_events[2].elements == SIZE);
+        assert(recorded_events[3].kind == VectorEvent::Kind::RELEASE);
+        assert(recorded_events[3].elements == SIZE + 1);
+        assert(recorded_events[3].old_capacity == SIZE * 2);
+    }
+}
+
+void Test17() {
+    const size_t SIZE = 10'000;
+    const ParallelPolicy policy{4, 100};
+    assert(PARALLEL.ChunkCount(1000) == 1);
+    assert(policy.ChunkCount(SIZE) == 4);
+    {
+        SharedObj::ResetCounters();
+        Vector<SharedObj> v(policy, SIZE);
+        assert(v.Size() == SIZE);
+        assert(SharedObj::num_alive == static_cast<int>(SIZE));
+        for(size_t i = 0; i != SIZE; ++i) {
+            v[i].id = i;
+        }
+        Vector<SharedObj> v_copy(policy, v);
+        assert(SharedObj::num_alive == static_cast<int>(SIZE * 2));
+        v_copy.Reserve(policy, SIZE * 3);
+        assert(v_copy.Capacity() == SIZE * 3);
+        v_copy.Resize(policy, SIZE * 2);
+        assert(SharedObj::num_alive == static_cast<int>(SIZE * 3));
+        for(size_t i = 0; i != SIZE; ++i) {
+            assert(v_copy[i].id == i);
+            assert(v_copy[SIZE + i].id == 0);
+        }
+    }
+    assert(SharedObj::num_alive == 0);
+    {
+        SharedObj::ResetCounters();
+        SharedObj::default_construction_throw_countdown = SIZE / 2;
+        try {
+            Vector<SharedObj> v(policy, SIZE);
+            assert(false && "Exception is expected");
+        } catch (const std::runtime_error&) {
+        }
+        assert(SharedObj::num_alive == 0);
+    }
+    {
+        SharedObj::ResetCounters();
+        Vector<SharedObj> v(policy, SIZE);
+        v[SIZE - 1].throw_on_copy = true;
+        try {
+            Vector<SharedObj> v_copy(policy, v);
+            assert(false && "Exception is expected");
+        } catch (const std::runtime_error&) {
+        }
+        assert(SharedObj::num_alive == static_cast<int>(SIZE));
+    }
+    {
+        Vector<int> v(SIZE);
+        for(size_t i = 0; i != SIZE; ++i) {
+            v[i] = static_cast<int>(i);
+        }
+        v.Reserve(policy, SIZE * 2);
+        for(size_t i = 0; i != SIZE; ++i) {
+            assert(v[i] == static_cast<int>(i));
+        }
+    }
+}
+
+void Test18() {
+    const size_t THREADS = 4;
+    const size_t PER_THREAD = 10'000;
+    {
+        SharedObj::ResetCounters();
+        ConcurrentVector<SharedObj, std::allocator<SharedObj>, 8> v;
+        assert(v.Size() == 0 && v.Capacity() == 0);
+        SharedObj& first = v.EmplaceBack();
+        first.id = THREADS * PER_THREAD;
+        std::atomic<bool> done = false;
+        std::thread reader([&v, &done] {
+            while(!done) {
+                for(const SharedObj& obj : v) {
+                    assert(obj.id <= THREADS * PER_THREAD);
+                }
+            }
+        });
+        std::vector<std::thread> producers;
+        for(size_t t = 0; t != THREADS; ++t) {
+            producers.emplace_back([&v, t] {
+                for(size_t i = 0; i != PER_THREAD; ++i) {
+                    SharedObj obj;
+                    obj.id = t * PER_THREAD + i;
+                    v.PushBack(std::move(obj));
+                }
+            });
+        }
+        for(std::thread& producer : producers) {
+            producer.join();
+        }
+        done = true;
+        reader.join();
+
+        assert(&v[0] == &first);
+        assert(v.Size() == THREADS * PER_THREAD + 1);
+        assert(v.Capacity() >= v.Size());
+        assert(SharedObj::num_alive == static_cast<int>(v.Size()));
+        std::vector<bool> seen(THREADS * PER_THREAD + 1);
+        for(const SharedObj& obj : v) {
+            assert(!seen[obj.id]);
+            seen[obj.id] = true;
+        }
+        assert(std::count(seen.begin(), seen.end(), true) == static_cast<long>(seen.size()));
+    }
+    assert(SharedObj::num_alive == 0);
+    {
+        SharedObj::ResetCounters();
+        ConcurrentVector<SharedObj> v;
+        v.Reserve(100);
+        assert(v.Capacity() >= 100);
+        v.EmplaceBack();
+        SharedObj::default_construction_throw_countdown = 1;
+        try {
+            v.EmplaceBack();
+            assert(false && "Exception is expected");
+        } catch (const std::runtime_error&) {
+        }
+        v.EmplaceBack();
+        assert(v.Size() == 3);
+        assert(v.IsReady(0) && !v.IsReady(1) && v.IsReady(2));
+        assert(std::distance(v.begin(), v.end()) == 2);
+        assert((++v.begin()).Index() == 2);
+    }
+    assert(SharedObj::num_alive == 0);
+}
+
+void Test19() {
+    const size_t BLOCK = 4;
+    {
+        SegmentedVector<int, BLOCK> v;
+        assert(v.begin() == v.end() && v.Capacity() == 0);
+        v.PushBack(0);
+        const int* first = &v[0];
+        for(int i = 1; i != 100; ++i) {
+            v.EmplaceBack(i);
+        }
+        assert(&v[0] == first);
+        assert(v.Size() == 100 && v.Capacity() == 100 && v.BlockCount() == 25);
+        assert(v.end() - v.begin() == 100);
+        assert(*(v.begin() + 37) == 37 && *(v.end() - 1) == 99 && v.begin()[98] == 98);
+        assert(*(v.end() - 37 + 10) == 73);
+        int expected = 99;
+        for(auto it = v.end(); it != v.begin(); --expected) {
+            --it;
+            assert(*it == expected);
+        }
+        std::reverse(v.begin(), v.end());
+        assert(v[0] == 99 && v[99] == 0);
+        std::sort(v.begin(), v.end());
+        assert(std::is_sorted(v.cbegin(), v.cend()) && v[50] == 50);
+
+        v.Insert(v.cbegin() + 10, 1000);
+        assert(v.Size() == 101 && v[10] == 1000 && v[11] == 10 && v[100] == 99);
+        v.Erase(v.cbegin() + 10);
+        assert(v.Size() == 100 && v[10] == 10 && v[99] == 99);
+        v.Insert(v.cend(), 100);
+        assert(v[100] == 100);
+
+        v.Resize(5);
+        assert(v.Size() == 5 && v.Capacity() == 104);
+        v.ShrinkToFit();
+        assert(v.Capacity() == 8 && v.BlockCount() == 2);
+        assert(&v[0] == first);
+        v.Resize(10);
+        assert(v[4] == 4 && v[9] == 0);
+        v.Reserve(20);
+        assert(v.Capacity() == 20);
+    }
+    {
+        Obj::ResetCounters();
+        SegmentedVector<Obj, BLOCK> v(10);
+        assert(Obj::GetAliveObjectCount() == 10);
+        SegmentedVector<Obj, BLOCK> v_copy(v);
+        assert(Obj::GetAliveObjectCount() == 20);
+        SegmentedVector<Obj, BLOCK> v_moved(std::move(v_copy));
+        assert(v_copy.Size() == 0 && v_moved.Size() == 10);
+        v_moved.Resize(3);
+        v = v_moved;
+        assert(v.Size() == 3 && Obj::GetAliveObjectCount() == 6);
+        v_moved.Resize(12);
+        v = std::move(v_moved);
+        assert(v.Size() == 12 && Obj::GetAliveObjectCount() == 12);
+        v.Swap(v_moved);
+        assert(v.Size() == 0 && v_moved.Size() == 12);
+    }
+    assert(Obj::GetAliveObjectCount() == 0);
+    {
+        Obj::ResetCounters();
+        SegmentedVector<Obj, BLOCK> v(6);
+        Obj::default_construction_throw_countdown = 3;
+        try {
+            v.Resize(10);
+            assert(false && "Exception is expected");
+        } catch (const std::runtime_error&) {
+        }
+        assert(v.Size() == 6 && Obj::GetAliveObjectCount() == 6);
+        v[5].throw_on_copy = true;
+        try {
+            SegmentedVector<Obj, BLOCK> v_copy(v);
+            assert(false && "Exception is expected");
+        } catch (const std::runtime_error&) {
+        }
+        assert(Obj::GetAliveObjectCount() == 6);
+    }
+    assert(Obj::GetAliveObjectCount() == 0);
+}
+
+#ifdef __linux__
+void Test20() {
+    struct Point {
+        int x;
+        double y;
+    };
+    {
+        MappedVector<int> v;
+        assert(!v.IsFileBacked() && v.Capacity() == 0 && v.begin() == v.end());
+        for(int i = 0; i != 10'000; ++i) {
+            v.PushBack(i);
+        }
+        assert(v.Size() == 10'000 && v.Capacity() >= 10'000);
+        v.Insert(v.cbegin(), v[9'999]);
+        v.Erase(v.cbegin() + 1);
+        assert(v[0] == 9'999 && v[1] == 1 && v[9'999] == 9'999);
+        v.Resize(5);
+        v.Resize(7);
+        assert(v.Size() == 7 && v[4] == 4 && v[6] == 0);
+    }
+
+    char path[] = "/tmp/advanced-vector-XXXXXX";
+    const int fd = mkstemp(path);
+    assert(fd != -1);
+    close(fd);
+    {
+        MappedVector<Point> v(path);
+        assert(v.IsFileBacked() && v.Size() == 0);
+        v.Reserve(10);
+        const size_t capacity = v.Capacity();
+        assert(capacity >= 10);
+        for(int i = 0; i != 100'000; ++i) {
+            v.EmplaceBack(Point{i, i * 0.5});
+        }
+        assert(v.Capacity() > capacity);
+        v.PopBack();
+        v.Sync();
+    }
+    {
+        MappedVector<Point> v(path);
+        assert(v.Size() == 99'999);
+        assert(v[0].x == 0 && v[99'998].x == 99'998 && v[99'998].y == 99'998 * 0.5);
+        v.PushBack(Point{-1, -1.0});
+    }
+    {
+        MappedVector<Point> v(path);
+        assert(v.Size() == 100'000 && v[99'999].x == -1);
+    }
+    try {
+        MappedVector<int> v(path);
+        assert(false && "Exception is expected");
+    } catch (const std::runtime_error&) {
+    }
+    std::remove(path);
+}
+
+void Test21() {
+    HugePageOptions options;
+    options.threshold = 1 << 16;
+    {
+        HugePageVector<int> v{HugePageAllocator<int>(options)};
+        for(int i = 0; i != 1'000'000; ++i) {
+            v.PushBack(i);
+        }
+        assert(v.Size() == 1'000'000 && v[999'999] == 999'999 && v[1234] == 1234);
+        HugePageVector<int> v_copy(v);
+        assert(v_copy.GetAllocator() == v.GetAllocator());
+        assert(v_copy[999'999] == 999'999);
+    }
+    {
+        options.page_size = HugePageOptions::PageSize::HUGE_2MB;
+        Vector<int, HugePageAllocator<int>> v(100'000, HugePageAllocator<int>(options));
+        v.Reserve(1'000'000);
+        v[99'999] = 1;
+        assert(v[99'999] == 1 && v[0] == 0);
+    }
+    {
+        options.page_size = HugePageOptions::PageSize::TRANSPARENT;
+        options.numa = HugePageOptions::NumaPolicy::BIND;
+        options.node_mask = 1;
+        Vector<int, HugePageAllocator<int>> v(PARALLEL, 1 << 20, HugePageAllocator<int>(options));
+        assert(v.Size() == 1 << 20 && v[(1 << 20) - 1] == 0);
+        options.numa = HugePageOptions::NumaPolicy::INTERLEAVE;
+        v = Vector<int, HugePageAllocator<int>>(1 << 20, HugePageAllocator<int>(options));
+        assert(v.GetAllocator().GetOptions().numa == HugePageOptions::NumaPolicy::INTERLEAVE);
+    }
+}
+#endif
+
+void Test22() {
+    {
+        Obj::ResetCounters();
+        Vector<Obj> v(5);
+        v[4].id = 4;
+        const Obj* data = v.Data();
+        BufferPtr<Obj> buffer = v.Release();
+        assert(v.Size() == 0 && v.Capacity() == 0 && v.Data() == nullptr);
+        assert(buffer.get() == data && buffer.get_deleter().Size() == 5 && buffer.get_deleter().Capacity() == 5);
+        assert(Obj::GetAliveObjectCount() == 5);
+
+        Vector<Obj> adopted(std::move(buffer));
+        assert(!buffer && adopted.Data() == data && adopted.Size() == 5 && adopted[4].id == 4);
+        adopted.PushBack(Obj(5));
+        assert(adopted.Size() == 6 && Obj::GetAliveObjectCount() == 6);
+
+        BufferPtr<Obj> released = adopted.Release();
+        released.reset();
+        assert(Obj::GetAliveObjectCount() == 0);
+        assert(!Vector<Obj>().Release());
+    }
+    {
+        // A buffer from a C API is adopted, grown and handed back without copies.
+        int* raw = static_cast<int*>(std::malloc(4 * sizeof(int)));
+        for(int i = 0; i != 3; ++i) {
+            raw[i] = i;
+        }
+        Vector<int, MallocAllocator<int>> v(ADOPT, raw, 3, 4);
+        v.PushBack(3);
+        assert(v.Data() == raw && v[3] == 3);
+        v.Reserve(1 << 20);
+        int* out = v.Release().release();
+        assert(out[3] == 3);
+        std::free(out);
+    }
+    {
+        Vector<int, std::allocator<int>, DoublingGrowthPolicy, VectorStats> v(3);
+        auto buffer = v.Release();
+        Vector<int, std::allocator<int>, DoublingGrowthPolicy, VectorStats> adopted(std::move(buffer));
+        assert(adopted.GetInstrumentation().peak_capacity == 3);
+    }
+}
+
+#ifdef __cpp_lib_span
+int SumOf(std::span<const int> values) {
+    return std::accumulate(values.begin(), values.end(), 0);
+}
+
+void Negate(std::span<int> values) {
+    for(int& value : values) {
+        value = -value;
+    }
+}
+#endif
+
+void Test23() {
+    Vector<int> v(4);
+    std::iota(v.begin(), v.end(), 1);
+    assert(v.Data() == &*v.begin());
+    assert(v.Front() == 1 && v.Back() == 4);
+    v.Front() = 10;
+    v.Back() = 40;
+    const Vector<int>& cv = v;
+    assert(cv.Data()[0] == 10 && cv.Front() == 10 && cv.Back() == 40);
+    assert(Vector<int>().Data() == nullptr);
+#ifdef __cpp_lib_span
+    const std::span<int> view = v;
+    assert(view.data() == v.Data() && view.size() == v.Size());
+    Negate(v);
+    assert(SumOf(cv) == -55 && SumOf(v) == -55);
+#endif
+#ifdef __cpp_lib_ranges
+    static_assert(std::ranges::contiguous_range<Vector<int>>);
+    static_assert(std::ranges::contiguous_range<const Vector<int>>);
+    static_assert(std::ranges::sized_range<Vector<int>>);
+    std::ranges::sort(v);
+    assert(std::ranges::is_sorted(v) && v.Front() == -40);
+    assert(std::ranges::data(v) == v.Data() && std::ranges::size(v) == 4);
+#endif
+}
+
+void Test24() {
+    {
+        Vector<int> v(10);
+        std::iota(v.begin(), v.end(), 0);
+        auto it = v.EraseUnordered(v.cbegin() + 2);
+        assert(*it == 9 && v.Size() == 9 && v[8] == 8);
+        it = v.EraseUnordered(v.cend() - 1);
+        assert(it == v.end() && v.Size() == 8);
+        it = v.EraseRange(v.cbegin() + 1, v.cbegin() + 4);
+        assert(*it == 4 && v.Size() == 5);
+        assert(v[0] == 0 && v[1] == 4 && v[4] == 7);
+        it = v.EraseRange(v.cbegin(), v.cbegin());
+        assert(it == v.begin() && v.Size() == 5);
+        const size_t erased = v.EraseIf([](int x) { return x % 2 == 0; });
+        assert(erased == 3);
+        assert(v.Size() == 2 && v[0] == 5 && v[1] == 7);
+    }
+    {
+        Obj::ResetCounters();
+        Vector<Obj> v;
+        for(int i = 0; i != 10; ++i) {
+            v.EmplaceBack(i);
+        }
+        v.EraseUnordered(v.cbegin());
+        assert(v[0].id == 9 && v.Size() == 9);
+        v.EraseRange(v.cbegin() + 1, v.cend() - 1);
+        assert(v.Size() == 2 && v[1].id == 8);
+        const size_t erased = v.EraseIf([](const Obj& obj) { return obj.id == 9; });
+        assert(erased == 1);
+        assert(v.Size() == 1 && v[0].id == 8 && Obj::GetAliveObjectCount() == 1);
+    }
+    assert(Obj::GetAliveObjectCount() == 0);
+    {
+        Vector<RelocatableObj> v;
+        for(int i = 0; i != 100; ++i) {
+            v.EmplaceBack(i);
+        }
+        RelocatableObj::num_moved = 0;
+        const size_t erased = v.EraseIf([](const RelocatableObj& obj) { return *obj.id % 3 != 0; });
+        assert(erased == 66);
+        assert(v.Size() == 34 && RelocatableObj::num_moved == 0);
+        for(size_t i = 0; i != v.Size(); ++i) {
+            assert(*v[i].id == static_cast<int>(i * 3));
+        }
+        v.EraseRange(v.cbegin(), v.cbegin() + 4);
+        v.EraseUnordered(v.cbegin());
+        assert(RelocatableObj::num_moved == 0 && *v[0].id == 99 && *v[1].id == 15);
+        try {
+            v.EraseIf([](const RelocatableObj& obj) {
+                if(*obj.id == 30) {
+                    throw std::runtime_error("Oops");
+                }
+                return *obj.id % 2 == 0;
+            });
+            assert(false && "Exception is expected");
+        } catch (const std::runtime_error&) {
+        }
+        assert(v.Size() == 27 && *v[0].id == 99 && *v[1].id == 15 && *v[2].id == 21 && *v[3].id == 27 && *v[4].id == 30);
+        assert(*v[26].id == 96);
+    }
+}
+
+// Allocator that fails once more than `limit` elements are requested.
+template<typename T>
+struct LimitedAllocator {
+    using value_type = T;
+
+    LimitedAllocator() = default;
+
+    template<typename U>
+    LimitedAllocator(const LimitedAllocator<U>&) noexcept {
+    }
+
+    T* allocate(const size_t count) {
+        if(T* ptr = try_allocate(count)) {
+            return ptr;
+        }
+        throw std::bad_alloc();
+    }
+
+    T* try_allocate(const size_t count) noexcept {
+        return count <= limit ? std::allocator<T>().allocate(count) : nullptr;
+    }
+
+    void deallocate(T* ptr, const size_t count) noexcept {
+        std::allocator<T>().deallocate(ptr, count);
+    }
+
+    template<typename U>
+    bool operator==(const LimitedAllocator<U>&) const noexcept {
+        return true;
+    }
+
+    template<typename U>
+    bool operator!=(const LimitedAllocator<U>&) const noexcept {
+        return false;
+    }
+
+    static inline size_t limit = 0;
+};
+
+void Test25() {
+    {
+        Vector<int> v;
+        VectorStatus status = v.TryReserve(SIZE_MAX / 2);
+        assert(status == VectorStatus::ALLOCATION_FAILED);
+        assert(v.Capacity() == 0);
+        status = v.TryReserve(10);
+        assert(status == VectorStatus::OK && v.Capacity() == 10);
+        status = v.TryResize(3);
+        assert(status == VectorStatus::OK && v.Size() == 3 && v[2] == 0);
+        for(int i = 0; i != 100; ++i) {
+            status = v.TryEmplaceBack(i);
+            assert(status == VectorStatus::OK);
+        }
+        assert(v.Size() == 103 && v[102] == 99);
+        status = v.TryResize(SIZE_MAX / 2);
+        assert(status == VectorStatus::ALLOCATION_FAILED && v.Size() == 103);
+    }
+    {
+        Obj::ResetCounters();
+        LimitedAllocator<Obj>::limit = 4;
+        Vector<Obj, LimitedAllocator<Obj>> v;
+        VectorStatus status = VectorStatus::OK;
+        for(int i = 0; i != 4; ++i) {
+            status = v.TryEmplaceBack(i);
+            assert(status == VectorStatus::OK);
+        }
+        const Obj obj(10);
+        status = v.TryPushBack(obj);
+        assert(status == VectorStatus::ALLOCATION_FAILED);
+        assert(v.Size() == 4 && v.Capacity() == 4 && v[3].id == 3);
+        status = v.TryReserve(5);
+        assert(status == VectorStatus::ALLOCATION_FAILED);
+        assert(Obj::GetAliveObjectCount() == 5);
+        LimitedAllocator<Obj>::limit = 8;
+        status = v.TryPushBack(v[0]);
+        assert(status == VectorStatus::OK);
+        assert(v.Size() == 5 && v[4].id == 0 && v.Capacity() == 8);
+    }
+    assert(Obj::GetAliveObjectCount() == 0);
+    {
+        Vector<int, MallocAllocator<int>> v;
+        VectorStatus status = v.TryReserve(SIZE_MAX / 2);
+        assert(status == VectorStatus::ALLOCATION_FAILED);
+        status = v.TryPushBack(1);
+        assert(status == VectorStatus::OK && v[0] == 1);
+        AlignedVector<int> aligned;
+        status = aligned.TryResize(17);
+        assert(status == VectorStatus::OK);
+        assert(reinterpret_cast<uintptr_t>(aligned.Data()) % CACHE_LINE_SIZE == 0);
+    }
+}
+
+void Test26() {
+    static_assert(BufferCache::BlockSize(1) == 64 && BufferCache::BlockSize(65) == 128);
+    static_assert(BufferCache::BlockSize(4096) == 4096 && BufferCache::BlockSize(4097) == 8192);
+    BufferCache::Purge();
+    BufferCache::ResetStats();
+    {
+        for(int i = 0; i != 1000; ++i) {
+            CachedVector<int> v;
+            for(int j = 0; j != 100; ++j) {
+                v.PushBack(j);
+            }
+            assert(v[99] == 99);
+        }
+        const BufferCacheStats stats = BufferCache::GetStats();
+        // Every vector grows through 8 capacities. Only the first one reaches
+        // the heap: twice for the 64-byte class, whose buffers it frees and
+        // reuses while growing, and once for each larger class.
+        assert(stats.misses == 5 && stats.hits == 1000 * 8 - 5);
+        assert(stats.parked == 1000 * 8 && stats.released == 0);
+        assert(stats.cached_bytes == 2 * 64 + 128 + 256 + 512);
+    }
+    {
+        BufferCache::SetBudget(1000);
+        assert(BufferCache::GetStats().cached_bytes == 0);
+        BufferCache::SetBudget(1024);
+        BufferCache::ResetStats();
+        {
+            CachedVector<char> a(1000);
+            CachedVector<char> b(1000);
+            CachedVector<char> huge(BufferCache::MAX_BLOCK_SIZE + 1);
+        }
+        const BufferCacheStats stats = BufferCache::GetStats();
+        assert(stats.parked == 1 && stats.released == 2 && stats.cached_bytes == 1024);
+        BufferCache::SetBudget(BufferCache::DEFAULT_BUDGET);
+    }
+    {
+        CachedVector<int> v(10);
+        std::thread worker([&v] {
+            BufferCache::ResetStats();
+            CachedVector<int> local(10);
+            v = local;
+            assert(BufferCache::GetStats().hits == 0);
+        });
+        worker.join();
+        assert(v.Size() == 10);
+    }
+    BufferCache::Purge();
+    assert(BufferCache::GetStats().cached_bytes == 0);
+}
+
+#ifdef __linux__
+void Test27() {
+    struct Point {
+        int x;
+        double y;
+    };
+    char path[] = "/tmp/advanced-vector-XXXXXX";
+    const int fd = mkstemp(path);
+    assert(fd != -1);
+    {
+        Vector<Point> points;
+        for(int i = 0; i != 100'000; ++i) {
+            points.PushBack(Point{i, i * 0.25});
+        }
+        WriteVector(fd, points);
+        lseek(fd, 0, SEEK_SET);
+        const Vector<Point> copy = ReadVector<Point>(fd);
+        assert(copy.Size() == points.Size() && copy.Capacity() == points.Size());
+        assert(copy[0].x == 0 && copy[99'999].x == 99'999 && copy[99'999].y == 99'999 * 0.25);
+
+        lseek(fd, 0, SEEK_SET);
+        VectorReader<Point> reader(fd);
+        assert(reader.Remaining() == 100'000);
+        Vector<Point> chunk;
+        size_t total = 0;
+        while(reader.Remaining() != 0) {
+            chunk.Resize(0);
+            const size_t count = reader.ReadChunk(chunk, 30'000);
+            assert(count == chunk.Size() && count <= 30'000);
+            assert(chunk[0].x == static_cast<int>(total));
+            total += count;
+        }
+        const size_t last = reader.ReadChunk(chunk);
+        assert(total == 100'000 && last == 0);
+    }
+    {
+        ftruncate(fd, 0);
+        lseek(fd, 0, SEEK_SET);
+        Vector<std::string> words;
+        for(int i = 0; i != 20'000; ++i) {
+            words.PushBack(std::string(static_cast<size_t>(i % 50), static_cast<char>('a' + i % 26)));
+        }
+        words.PushBack(std::string(100'000, 'z'));
+        WriteVector(fd, words);
+        lseek(fd, 0, SEEK_SET);
+        const Vector<std::string> copy = ReadVector<std::string>(fd);
+        assert(copy.Size() == words.Size() && std::equal(copy.begin(), copy.end(), words.begin()));
+
+        lseek(fd, 0, SEEK_SET);
+        try {
+            VectorReader<int> wrong(fd);
+            assert(false && "Exception is expected");
+        } catch (const std::runtime_error&) {
+        }
+    }
+    {
+        ftruncate(fd, 0);
+        lseek(fd, 0, SEEK_SET);
+        WriteVector(fd, Vector<int>(1000));
+        ftruncate(fd, static_cast<off_t>(lseek(fd, 0, SEEK_CUR) - 1));
+        lseek(fd, 0, SEEK_SET);
+        VectorReader<int> reader(fd);
+        Vector<int> v;
+        try {
+            reader.ReadAll(v);
+            assert(false && "Exception is expected");
+        } catch (const std::runtime_error&) {
+        }
+        assert(v.Size() == 0);
+    }
+    {
+        // A corrupt count is not reserved up front.
+        ftruncate(fd, 0);
+        lseek(fd, 0, SEEK_SET);
+        WriteVector(fd, Vector<int>(10));
+        for(const uint64_t count : {uint64_t{1} << 60, ~uint64_t{0}}) {
+            pwrite(fd, &count, sizeof(count), offsetof(detail::SerializedHeader, count));
+            lseek(fd, 0, SEEK_SET);
+            VectorReader<int> reader(fd);
+            Vector<int> v;
+            try {
+                reader.ReadAll(v);
+                assert(false && "Exception is expected");
+            } catch (const std::runtime_error&) {
+            }
+            assert(v.Size() == 0 && v.Capacity() <= 10 + VectorReader<int>::DEFAULT_CHUNK);
+        }
+
+        int pipe_fds[2];
+        const int piped = pipe(pipe_fds);
+        assert(piped == 0);
+        Vector<int> numbers(1000);
+        std::iota(numbers.begin(), numbers.end(), 0);
+        WriteVector(pipe_fds[1], numbers);
+        close(pipe_fds[1]);
+        const Vector<int> copy = ReadVector<int>(pipe_fds[0]);
+        close(pipe_fds[0]);
+        assert(copy == numbers && copy.Capacity() == 1000);
+    }
+    close(fd);
+    std::remove(path);
+}
+#endif
+
+void Test28() {
+    {
+        SoAVector<int, double, std::string> v;
+        assert(v.Size() == 0 && v.Capacity() == 0 && v.begin() == v.end());
+        for(int i = 0; i != 1000; ++i) {
+            v.EmplaceBack(i, i * 0.5, std::to_string(i));
+        }
+        assert(v.Size() == 1000 && v.Capacity() >= 1000);
+        assert(v.Get<0>(10) == 10 && v.Get<1>(10) == 5.0 && v.Get<2>(10) == "10");
+
+        auto [id, weight, name] = v[999];
+        id = -1;
+        weight += 1.0;
+        assert(v.Get<0>(999) == -1 && v.Get<1>(999) == 999 * 0.5 + 1.0 && name == "999");
+
+        const auto ids = v.Column<0>();
+        assert(ids.Size() == 1000 && ids.Data() + 1 == &v.Get<0>(1));
+        assert(std::accumulate(ids.begin(), ids.end(), 0LL) == 999LL * 998 / 2 - 1);
+
+        v.Erase(v.cbegin());
+        assert(v.Size() == 999 && v.Get<0>(0) == 1 && v.Get<2>(0) == "1");
+        v.EraseUnordered(v.begin() + 1);
+        assert(v.Size() == 998 && v.Get<0>(1) == -1 && v.Get<2>(1) == "999");
+
+        v.EmplaceBack(v.Get<0>(0), v.Get<1>(0), v.Get<2>(0));
+        assert(v.Size() == 999 && v.Get<2>(998) == "1");
+
+        size_t rows = 0;
+        for(const auto& [row_id, row_weight, row_name] : std::as_const(v)) {
+            assert(row_name.empty() || row_weight >= 0.0 || row_id < 0);
+            ++rows;
+        }
+        assert(rows == v.Size());
+
+        auto copy = v;
+        assert(copy.Size() == v.Size() && copy.Get<2>(998) == "1");
+        auto moved = std::move(copy);
+        assert(moved.Size() == v.Size() && copy.Size() == 0);
+
+        v.Resize(5);
+        assert(v.Size() == 5 && v.Capacity() >= 998);
+        v.ShrinkToFit();
+        assert(v.Capacity() == 5);
+        v.EmplaceBack(v.Get<0>(0), v.Get<1>(0), v.Get<2>(0));
+        assert(v.Capacity() == 10 && v.Get<2>(5) == "1");
+        v.Resize(7);
+        assert(v.Get<0>(6) == 0 && v.Get<1>(6) == 0.0 && v.Get<2>(6).empty());
+        v.Reserve(100);
+        assert(v.Capacity() == 100 && v.Get<2>(0) == "1");
+        v.PopBack();
+        assert(v.Size() == 6);
+#ifdef __cpp_lib_span
+        const std::span<const double> weights = std::as_const(v).Column<1>();
+        assert(weights.size() == 6);
+#endif
+    }
+    Obj::ResetCounters();
+    {
+        SoAVector<Obj, int> v;
+        v.EmplaceBack(Obj(1), 1);
+        v.Reserve(10);
+        Obj::default_construction_throw_countdown = 3;
+        try {
+            v.Resize(4);
+            assert(false && "Exception is expected");
+        } catch (const std::runtime_error&) {
+        }
+        assert(v.Size() == 1 && v.Get<0>(0).id == 1);
+
+        Obj bad(2);
+        bad.throw_on_copy = true;
+        try {
+            v.EmplaceBack(bad, 2);
+            assert(false && "Exception is expected");
+        } catch (const std::runtime_error&) {
+        }
+        assert(v.Size() == 1);
+        assert(Obj::GetAliveObjectCount() == 2);
+    }
+    assert(Obj::GetAliveObjectCount() == 0);
+    {
+        // The string column could be moved, but the second one can only be
+        // copied and may throw, so all of them must be copied.
+        struct Fragile {
+            explicit Fragile(const int id)
+            : id(id) {
+            }
+
+            Fragile(const Fragile& other)
+            : id(other.id) {
+                if(other.throw_on_copy) {
+                    throw std::runtime_error("Oops");
+                }
+            }
+
+            int id;
+            bool throw_on_copy = false;
+        };
+        static_assert(!std::is_nothrow_move_constructible_v<Fragile>);
+
+        SoAVector<std::string, Fragile> v;
+        v.Reserve(2);
+        v.EmplaceBack(std::string(100, 'a'), Fragile(1));
+        v.EmplaceBack(std::string(100, 'b'), Fragile(2));
+        v.Get<1>(1).throw_on_copy = true;
+        try {
+            v.Reserve(10);
+            assert(false && "Exception is expected");
+        } catch (const std::runtime_error&) {
+        }
+        assert(v.Size() == 2 && v.Capacity() == 2);
+        assert(v.Get<0>(0) == std::string(100, 'a') && v.Get<0>(1) == std::string(100, 'b'));
+        try {
+            v.EmplaceBack(std::string(100, 'c'), Fragile(3));
+            assert(false && "Exception is expected");
+        } catch (const std::runtime_error&) {
+        }
+        assert(v.Size() == 2 && v.Get<0>(0) == std::string(100, 'a') && v.Get<0>(1) == std::string(100, 'b'));
+    }
+}
+
+template<typename T>
+void CheckSimdKernels(const Vector<T>& v) {
+    const std::vector<T> ref(v.begin(), v.end());
+    for(const T needle : {T(0), T(1), T(7), T(100)}) {
+        assert(v.Find(needle) - v.begin() == std::find(ref.begin(), ref.end(), needle) - ref.begin());
+        assert(v.Count(needle) == static_cast<size_t>(std::count(ref.begin(), ref.end(), needle)));
+    }
+    if(v.Size() != 0) {
+        assert(v.Min() == *std::min_element(ref.begin(), ref.end()));
+        assert(v.Max() == *std::max_element(ref.begin(), ref.end()));
+    }
+    if constexpr (std::is_integral_v<T>) {
+        std::make_unsigned_t<T> sum = 0;
+        for(const T elem : ref) {
+            sum += static_cast<std::make_unsigned_t<T>>(elem);
+        }
+        assert(v.Sum() == static_cast<T>(sum));
+    } else {
+        const T sum = std::accumulate(ref.begin(), ref.end(), T(0));
+        assert(std::abs(v.Sum() - sum) <= std::abs(sum) * T(1e-5));
+    }
+    Vector<T> copy = v;
+    assert(copy == v && !(copy != v) && !(copy < v) && copy <= v && copy >= v);
+    if(v.Size() != 0) {
+        copy[v.Size() - 1] = static_cast<T>(copy[v.Size() - 1] + 1);
+        assert(copy != v && (v < copy) == (ref.back() < copy[v.Size() - 1]));
+        copy.PopBack();
+        assert(copy < v && v > copy);
+    }
+}
+
+template<typename T>
+void CheckSimdKernels() {
+    for(const size_t size : {size_t{0}, size_t{1}, size_t{15}, size_t{16}, size_t{63}, size_t{64}, size_t{100}, size_t{1001}}) {
+        Vector<T> v(size);
+        for(size_t i = 0; i != size; ++i) {
+            v[i] = static_cast<T>(static_cast<int>((i * 37 + 11) % 101) - 40);
+        }
+        CheckSimdKernels(v);
+    }
+}
+
+void Test29() {
+    const SimdLevel detected = GetSimdLevel();
+    for(const SimdLevel level : {SimdLevel::SCALAR, SimdLevel::SSE2, SimdLevel::NEON, SimdLevel::AVX2, SimdLevel::AVX512}) {
+        SetSimdLevel(level);
+        assert(GetSimdLevel() == level || GetSimdLevel() == detected);
+        CheckSimdKernels<int8_t>();
+        CheckSimdKernels<uint8_t>();
+        CheckSimdKernels<int16_t>();
+        CheckSimdKernels<uint32_t>();
+        CheckSimdKernels<int64_t>();
+        CheckSimdKernels<char>();
+        CheckSimdKernels<float>();
+        CheckSimdKernels<double>();
+        {
+            // Long runs of matches overflow narrow lane counters.
+            Vector<char> bytes(100'003);
+            bytes.Fill('a');
+            assert(bytes.Count('a') == 100'003 && bytes.Find('b') == bytes.end());
+            bytes[100'000] = 'b';
+            assert(bytes.Find('b') == bytes.begin() + 100'000 && bytes.Count('a') == 100'002);
+            Vector<uint16_t> words(200'000);
+            assert(words.Count(0) == 200'000 && words.Sum() == 0);
+        }
+        {
+            const double nan = std::numeric_limits<double>::quiet_NaN();
+            Vector<double> v(40);
+            v.Fill(2.0);
+            v[3] = nan;
+            v[33] = -1.0;
+            v[17] = 5.0;
+            assert(v.Min() == -1.0 && v.Max() == 5.0 && v.Find(nan) == v.end() && v.Count(nan) == 0);
+            v[0] = nan;
+            assert(std::isnan(v.Min()) && std::isnan(v.Max()));
+        }
+    }
+    SetSimdLevel(detected);
+    {
+        using namespace std::literals;
+        Vector<std::string> a;
+        a.PushBack("x"s);
+        a.PushBack("y"s);
+        Vector<std::string> b = a;
+        assert(a == b && a.Find("y"s) == a.begin() + 1 && a.Count("z"s) == 0);
+        b[1] = "z"s;
+        assert(a < b && a.Min() == "x"s && b.Max() == "z"s && a.Sum() == "xy"s);
+    }
+}
+
+#ifdef ADVANCED_VECTOR_HAS_CONSTEXPR
+constexpr Vector<uint32_t> MakeCrcTable() {
+    Vector<uint32_t> table;
+    for(uint32_t i = 0; i != 256; ++i) {
+        uint32_t crc = i;
+        for(int bit = 0; bit != 8; ++bit) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+        table.PushBack(crc);
+    }
+    return table;
+}
+
+constexpr bool ConstexprVectorWorks() {
+    Vector<std::string> words;
+    words.Reserve(2);
+    words.EmplaceBack("b");
+    words.Insert(words.begin(), "a");
+    words.PushBack("d");
+    words.Emplace(words.begin() + 2, 3, 'c');
+    words.Erase(words.begin() + 3);
+    words.EraseIf([](const std::string& word) {
+        return word == "a";
+    });
+    // {"b", "ccc"}
+    Vector<std::string> copy = words;
+    copy.Resize(3);
+    copy.Insert(copy.end(), 2, "e");
+    const Vector<std::string> moved = std::move(copy);
+    Vector<int> numbers(5);
+    numbers.EraseUnordered(numbers.begin());
+    numbers.ShrinkToFit();
+    return words.Size() == 2 && words[1] == "ccc" && moved.Size() == 5 && moved[2].empty() && moved.Back() == "e"
+        && words < moved && copy.Size() == 0 && numbers.Capacity() == 4 && numbers == Vector<int>(4);
+}
+
+static_assert(ConstexprVectorWorks());
+
+constexpr auto CRC_TABLE = ToArray<256>(MakeCrcTable());
+constexpr auto SQUARES = ToArray<[] {
+    Vector<int> squares;
+    for(int i = 0; i != 10; ++i) {
+        squares.PushBack(i * i);
+    }
+    return squares;
+}>();
+#endif
+
+void Test30() {
+#ifdef ADVANCED_VECTOR_HAS_CONSTEXPR
+    static_assert(CRC_TABLE[1] == 0x77073096u && CRC_TABLE[255] == 0x2D02EF8Du);
+    static_assert(SQUARES.size() == 10 && SQUARES[9] == 81);
+    const Vector<uint32_t> table = MakeCrcTable();
+    assert(std::equal(table.begin(), table.end(), CRC_TABLE.begin(), CRC_TABLE.end()));
+    assert(ConstexprVectorWorks());
+#endif
+}
+
+void Test31() {
+    using namespace std::literals;
+    static_assert(std::is_trivially_copyable_v<InplaceVector<int, 4>>);
+    static_assert(!std::is_trivially_copyable_v<InplaceVector<std::string, 4>>);
+    static_assert(InplaceVector<int, 4>::Capacity() == 4);
+    {
+        InplaceVector<int, 4> v{1, 2, 3};
+        VectorStatus status = v.TryEmplaceBack(4);
+        assert(status == VectorStatus::OK && v.Full());
+        status = v.TryPushBack(5);
+        assert(status == VectorStatus::CAPACITY_EXCEEDED && v.Size() == 4);
+        status = v.TryResize(5);
+        assert(status == VectorStatus::CAPACITY_EXCEEDED && v.Size() == 4);
+        bool thrown = false;
+        try {
+            v.Insert(v.begin(), 0);
+        } catch (const std::bad_alloc&) {
+            thrown = true;
+        }
+        assert(thrown && v.Size() == 4 && v[0] == 1);
+        InplaceVector<int, 4> copy;
+        std::memcpy(static_cast<void*>(&copy), &v, sizeof(v));
+        copy.Erase(copy.begin() + 1);
+        copy.Insert(copy.begin(), 0);
+        assert(copy.Size() == 4 && copy[0] == 0 && copy[1] == 1 && copy[2] == 3 && copy[3] == 4);
+        v.Erase(v.begin());
+        v.PopBack();
+        v.Resize(3);
+        assert(v.Size() == 3 && v[0] == 2 && v[1] == 3 && v[2] == 0);
+    }
+    {
+        Obj::ResetCounters();
+        {
+            InplaceVector<Obj, 5> v(2);
+            const Obj& back = v.EmplaceBack(1, "a"s);
+            assert(back.name == "a"s);
+            v.Emplace(v.begin(), 7);
+            assert(v.Size() == 4 && v[0].id == 7 && v[3].id == 1);
+            Obj obj(3);
+            obj.throw_on_copy = true;
+            bool thrown = false;
+            try {
+                v.Insert(v.begin() + 1, obj);
+            } catch (const std::runtime_error&) {
+                thrown = true;
+            }
+            assert(thrown && v.Size() == 4 && v[0].id == 7 && v[1].id == 0);
+            InplaceVector<Obj, 5> copy = v;
+            assert(copy.Size() == 4 && copy[3].id == 1);
+            InplaceVector<Obj, 5> moved = std::move(copy);
+            assert(moved.Size() == 4 && copy.Size() == 0);
+            moved.Erase(moved.begin());
+            moved.Swap(copy);
+            assert(moved.Size() == 0 && copy.Size() == 3 && copy[2].id == 1);
+            copy = v;
+            assert(copy.Size() == 4 && copy[0].id == 7);
+            v.Resize(1);
+            copy = std::move(v);
+            assert(copy.Size() == 1 && v.Size() == 0);
+        }
+        assert(Obj::GetAliveObjectCount() == 0);
+    }
+}
+
+void Test32() {
+    using namespace std::literals;
+    {
+        SharedVector<int> empty;
+        assert(empty.Size() == 0 && empty.UseCount() == 0 && empty.begin() == empty.end());
+        empty.PushBack(1);
+        assert(empty.IsUnique() && empty[0] == 1);
+    }
+    {
+        Vector<std::string> table;
+        table.PushBack("a"s);
+        table.PushBack("b"s);
+        const std::string* elements = table.Data();
+        const SharedVector<std::string> snapshot = Freeze(std::move(table));
+        assert(snapshot.Data() == elements && snapshot.Size() == 2 && table.Size() == 0);
+
+        SharedVector<std::string> reader = snapshot;
+        assert(reader.Data() == elements && snapshot.UseCount() == 2);
+        reader.PushBack("c"s);
+        assert(reader.Data() != elements && reader.IsUnique() && snapshot.IsUnique());
+        assert(reader.Size() == 3 && snapshot.Size() == 2 && snapshot[1] == "b"s);
+        const std::string* own = reader.Data();
+        reader.Mutate()[0] = "z"s;
+        assert(reader.Data() == own && reader[0] == "z"s && snapshot[0] == "a"s);
+
+        SharedVector<std::string> other = snapshot;
+        Vector<std::string> copy = std::move(other).Thaw();
+        assert(copy.Size() == 2 && copy.Data() != elements && other.UseCount() == 0);
+        Vector<std::string> stolen = std::move(reader).Thaw();
+        assert(stolen.Data() == own && stolen.Size() == 3);
+    }
+    {
+        Vector<int> numbers(1 << 12);
+        std::iota(numbers.begin(), numbers.end(), 0);
+        const auto snapshot = Freeze(std::move(numbers));
+        std::atomic<long long> total{0};
+        std::vector<std::thread> readers;
+        for(int i = 0; i < 4; ++i) {
+            readers.emplace_back([snapshot, &total] {
+                for(int round = 0; round < 100; ++round) {
+                    SharedVector<int> local = snapshot;
+                    total += std::accumulate(local.begin(), local.end(), 0LL);
+                }
+            });
+        }
+        for(std::thread& reader : readers) {
+            reader.join();
+        }
+        assert(total == 400LL * ((1 << 12) - 1) * (1 << 12) / 2 && snapshot.IsUnique());
+    }
+}
+
+int hardening_failures = 0;
+
+void CountHardeningFailure(const char* /*message*/) noexcept {
+    ++hardening_failures;
+}
+
+void Test33() {
+    using detail::hardening::CheckedGeneration;
+    using detail::hardening::CheckedIterator;
+    int data[4] = {1, 2, 3, 4};
+    SetHardeningHandler(&CountHardeningFailure);
+    // Tracks every iterator in the sampled mode too.
+    const uint32_t sample_period = GetHardeningSamplePeriod();
+    SetHardeningSamplePeriod(1);
+    {
+        CheckedGeneration generation;
+        const CheckedIterator<int> it = generation.MakeIterator(data + 1, data, data + 3);
+        const CheckedIterator<const int> const_it = it;
+        assert(*it == 2 && const_it[1] == 3 && (it + 2) - const_it == 2 && it + 1 > const_it);
+        generation.CheckIterator(const_it + 2);
+        assert(hardening_failures == 0);
+        // Past the elements the iterator was obtained with.
+        (void)it[2];
+        assert(hardening_failures == 1);
+        generation.Bump();
+        (void)*it;
+        generation.CheckIterator(const_it);
+        assert(hardening_failures == 3);
+        CheckedGeneration other;
+        other.CheckIterator(generation.MakeIterator(data, data, data + 3));
+        assert(hardening_failures == 4);
+        const CheckedIterator<int> untracked(data, data, data + 3, nullptr);
+        other.CheckIterator(untracked);
+        (void)untracked[3];
+        assert(hardening_failures == 4);
+    }
+#ifdef ADVANCED_VECTOR_CHECKED
+    // Only violations that stay memory-safe once the handler returns.
+    hardening_failures = 0;
+    {
+        // The arena keeps the old buffer readable after the reallocation.
+        std::pmr::monotonic_buffer_resource arena;
+        Vector<int, std::pmr::polymorphic_allocator<int>> v(4, &arena);
+        const auto it = v.begin() + 1;
+        v.Reserve(100);
+        (void)*it;
+        assert(hardening_failures == 1);
+    }
+    {
+        Vector<int> v(4);
+        auto it = v.begin();
+        (void)it[3];
+        v.Insert(v.begin() + 1, 1);
+        assert(hardening_failures == 1);
+        it = v.begin() + 1;
+        v.Erase(v.begin() + 3);
+        (void)*it;
+        assert(hardening_failures == 2);
+    }
+    {
+        // The elements now belong to `b`, but the iterator came from `a`.
+        Vector<int> a(4);
+        const auto it = a.cbegin() + 2;
+        Vector<int> b(std::move(a));
+        b.Emplace(it, 7);
+        assert(hardening_failures == 3 && b.Size() == 5 && b[2] == 7);
+        b.Emplace(b.cbegin() + 2, 8);
+        assert(hardening_failures == 3);
+    }
+    {
+        Vector<int> v(4);
+        v.Reserve(8);
+        (void)v[3];
+        assert(hardening_failures == 3);
+        (void)v[5];
+        (void)std::as_const(v)[4];
+        assert(hardening_failures == 5);
+    }
+#ifdef __cpp_lib_ranges
+    static_assert(std::contiguous_iterator<Vector<int>::iterator>);
+    static_assert(std::contiguous_iterator<Vector<int>::const_iterator>);
+    {
+        Vector<int> v(3);
+        assert(std::to_address(v.end()) == v.Data() + 3 && std::ranges::data(std::as_const(v)) == v.Data());
+        assert(hardening_failures == 5);
+    }
+#endif
+#endif
+    SetHardeningHandler(nullptr);
+    SetHardeningSamplePeriod(7);
+    assert(GetHardeningSamplePeriod() == 7);
+    SetHardeningSamplePeriod(sample_period);
+}
+
+void Test34() {
+    using namespace std::literals;
+    const auto ints = [](std::initializer_list<int> init) {
+        return Vector<int>(init.begin(), init.end());
+    };
+    const auto strings = [](std::initializer_list<std::string> init) {
+        return Vector<std::string>(init.begin(), init.end());
+    };
+    {
+        Vector<int> a(3);
+        std::iota(a.begin(), a.end(), 0);
+        Vector<int> b(3);
+        std::iota(b.begin(), b.end(), 10);
+        const int* a_data = a.Data();
+        Vector<int> empty;
+        empty.Append(std::move(a));
+        assert(empty.Data() == a_data && empty.Size() == 3 && a.Size() == 0 && a.Capacity() == 0);
+        empty.Splice(empty.begin() + 1, std::move(b));
+        assert(b.Size() == 0 && empty.Size() == 6);
+        assert(empty == ints({0, 10, 11, 12, 1, 2}));
+        Vector<int> tail = empty.Split(empty.begin() + 4);
+        assert(tail.Capacity() == 2 && tail == ints({1, 2}) && empty == ints({0, 10, 11, 12}));
+        const int* data = empty.Data();
+        Vector<int> whole = empty.Split(empty.begin());
+        assert(whole.Data() == data && whole.Size() == 4 && empty.Size() == 0);
+        const Vector<int> nothing = whole.Split(whole.end());
+        assert(nothing.Size() == 0 && whole.Size() == 4);
+    }
+    {
+        Obj::ResetCounters();
+        {
+            Vector<Obj> a;
+            a.Reserve(8);
+            a.EmplaceBack(1);
+            a.EmplaceBack(2);
+            Vector<Obj> b;
+            b.EmplaceBack(3, "c"s);
+            b.EmplaceBack(4);
+            a.Splice(a.begin() + 1, std::move(b));
+            assert(a.Size() == 4 && a[0].id == 1 && a[1].id == 3 && a[2].id == 4 && a[3].id == 2);
+            // Not enough room: both sides go to one new buffer.
+            Vector<Obj> c(5);
+            a.Splice(a.end(), std::move(c));
+            assert(a.Size() == 9 && a[8].id == 0 && c.Size() == 0 && Obj::num_copied == 0);
+            Vector<Obj> back = a.Split(a.begin() + 3);
+            assert(back.Size() == 6 && back[0].id == 2 && a.Size() == 3 && Obj::num_copied == 0);
+            Vector<Obj> empty;
+            empty.Reserve(10);
+            const Obj* reserved = empty.Data();
+            empty.Append(std::move(a));
+            assert(empty.Data() == reserved && empty.Size() == 3 && Obj::num_copied == 0);
+        }
+        assert(Obj::GetAliveObjectCount() == 0);
+    }
+    {
+        Vector<std::string> x = strings({"a"s, "b"s});
+        Vector<std::string> y = strings({"c"s});
+        const Vector<std::string> z = strings({"d"s, "e"s});
+        const std::string* y_data = y.Data();
+        Vector<std::string> all = Concat(std::move(x), std::move(y), z);
+        assert(all.Size() == 5 && all.Capacity() == 5 && all[2] == "c"s && all[4] == "e"s);
+        assert(x.Size() == 0 && y.Size() == 0 && y_data != all.Data() && z.Size() == 2);
+
+        // An lvalue first argument is copied once, straight into the result.
+        Obj::ResetCounters();
+        {
+            Vector<Obj> left(3);
+            Vector<Obj> right(2);
+            const Vector<Obj> both = Concat(left, std::move(right));
+            assert(both.Size() == 5 && both.Capacity() == 5 && left.Size() == 3);
+            assert(Obj::num_copied == 3 && Obj::num_moved == 2);
+        }
+        assert(Obj::GetAliveObjectCount() == 0);
+
+        Vector<Vector<int>> parts;
+        for(int i = 0; i != 100; ++i) {
+            parts.EmplaceBack(static_cast<size_t>(i % 7));
+            parts.Back().Fill(i);
+        }
+        const Vector<int> copied = ConcatAll(parts);
+        const Vector<int> merged = ConcatAll(std::move(parts));
+        assert(merged == copied && merged.Capacity() == merged.Size() && parts[1].Size() == 0);
+        assert(std::accumulate(merged.begin(), merged.end(), 0LL) == std::accumulate(copied.begin(), copied.end(), 0LL));
+    }
+}
+
+void Test35() {
+    const auto find_site = [](const Vector<VectorSiteReport>& report, const uint32_t line) {
+        return std::find_if(report.begin(), report.end(), [line](const VectorSiteReport& entry) {
+            return entry.site.line == line && std::string_view(entry.site.file).find("main.cpp") != std::string_view::npos;
+        });
+    };
+    {
+        ProfiledVector<int> untracked(ProfileHere());
+        untracked.PushBack(1);
+        assert(!untracked.GetInstrumentation().IsTracked());
+    }
+    VectorProfiler::Enable();
+    const uint32_t grown_line = __LINE__ + 1;
+    ProfiledVector<int> grown(ProfileHere());
+    for(int i = 0; i != 100; ++i) {
+        grown.PushBack(i);
+    }
+    const uint32_t reserved_line = __LINE__ + 2;
+    for(int i = 0; i != 3; ++i) {
+        ProfiledVector<uint64_t> reserved(ProfileHere());
+        reserved.Reserve(10);
+        reserved.PushBack(1);
+    }
+    ProfiledVector<int> moved = std::move(grown);
+    const ProfiledVector<int> copy = moved;
+    assert(moved.GetInstrumentation().IsTracked() && copy.GetInstrumentation().IsTracked());
+    {
+        const Vector<VectorSiteReport> report = VectorProfiler::Report();
+        const auto grown_site = find_site(report, grown_line);
+        assert(grown_site != report.end() && grown_site->vectors == 1 && grown_site->live_vectors == 1);
+        assert(grown_site->live_bytes == 128 * sizeof(int) && grown_site->reallocations == 7);
+        const auto reserved_site = find_site(report, reserved_line);
+        assert(reserved_site != report.end() && reserved_site->vectors == 3 && reserved_site->live_vectors == 0);
+        assert(reserved_site->live_bytes == 0 && reserved_site->wasted_bytes == 3 * 9 * sizeof(uint64_t));
+        assert(reserved_site->reallocation_histogram[0] == 3 && reserved_site->allocated_bytes == 3 * 80);
+    }
+    std::ostringstream json;
+    VectorProfiler::WriteJson(json);
+    assert(json.str().find("\"line\":" + std::to_string(grown_line) + ",") != std::string::npos);
+    std::ostringstream pprof;
+    VectorProfiler::WritePprof(pprof);
+    assert(!pprof.str().empty() && pprof.str().find("wasted_bytes") != std::string::npos);
+    {
+        // Buffers handed over by move assignment and Swap are charged to the
+        // vector that holds them.
+        const auto build = [] {
+            ProfiledVector<int> built;
+            built.Resize(1000);
+            return built;
+        };
+        const uint32_t member_line = __LINE__ + 1;
+        ProfiledVector<int> member(ProfileHere());
+        member.PushBack(1);
+        member = build();
+        const uint32_t other_line = __LINE__ + 1;
+        ProfiledVector<int> other(ProfileHere());
+        other.Resize(10);
+        const size_t member_bytes = member.Capacity() * sizeof(int);
+        const size_t other_bytes = other.Capacity() * sizeof(int);
+        {
+            const Vector<VectorSiteReport> report = VectorProfiler::Report();
+            const auto member_site = find_site(report, member_line);
+            const auto other_site = find_site(report, other_line);
+            assert(member_site != report.end() && member_site->live_bytes == member_bytes && member_bytes == 4000);
+            assert(other_site != report.end() && other_site->live_bytes == other_bytes);
+        }
+        member.Swap(other);
         {
-            cerr << "Vector:"sv << endl;
-            C::Reset();
-            Vector<C> v(NUM);
-            Dump();
-            v.PushBack(c);
+            const Vector<VectorSiteReport> report = VectorProfiler::Report();
+            assert(find_site(report, member_line)->live_bytes == other_bytes);
+            assert(find_site(report, other_line)->live_bytes == member_bytes);
         }
-        Dump();
-    } catch (...) {
     }
+    VectorProfiler::Disable();
+    ProfiledVector<int> after(ProfileHere());
+    assert(!after.GetInstrumentation().IsTracked() && VectorProfiler::GetSamplePeriod() == 0);
 }
 
 int main() {
@@ -638,7 +2562,39 @@ int main() {
         Test4();
         Test5();
         Test6();
-        Benchmark();
+        Test7();
+        Test8();
+        Test9();
+        Test10();
+        Test11();
+        Test12();
+        Test13();
+        Test14();
+        Test15();
+        Test16();
+        Test17();
+        Test18();
+        Test19();
+#ifdef __linux__
+        Test20();
+        Test21();
+#endif
+        Test22();
+        Test23();
+        Test24();
+        Test25();
+        Test26();
+#ifdef __linux__
+        Test27();
+#endif
+        Test28();
+        Test29();
+        Test30();
+        Test31();
+        Test32();
+        Test33();
+        Test34();
+        Test35();
     } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
     }
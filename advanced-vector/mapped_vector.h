@@ -0,0 +1,366 @@
+#pragma once
+
+#include "vector.h"
+
+#if !defined(__linux__)
+#error "mapped_vector.h relies on Linux mmap/mremap"
+#endif
+
+#include <cerrno>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace detail {
+
+// Stored at the start of every mapping; the elements follow at
+// MAPPED_HEADER_SIZE so they keep up to cache-line alignment.
+struct MappedHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t elem_size;
+    uint64_t size;
+};
+
+inline constexpr uint64_t MAPPED_MAGIC = 0x524f544345564441;  // "ADVECTOR"
+inline constexpr uint32_t MAPPED_VERSION = 1;
+inline constexpr size_t MAPPED_HEADER_SIZE = CACHE_LINE_SIZE;
+
+inline size_t PageSize() noexcept {
+    static const size_t page_size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    return page_size;
+}
+
+}  // namespace detail
+
+// Storage for trivially copyable T on a shared mapping of a file, or on an
+// anonymous mapping advised to use transparent huge pages. The element count
+// lives in the mapped header, so a file can be reopened and used in place.
+// Growth extends the file with ftruncate and the mapping with mremap, which
+// may move it like realloc does.
+template<typename T>
+class MappedMemory {
+    static_assert(std::is_trivially_copyable_v<T>, "MappedMemory stores raw bytes of T");
+    static_assert(alignof(T) <= detail::MAPPED_HEADER_SIZE, "T is over-aligned for MappedMemory");
+
+public:
+    MappedMemory() = default;
+
+    // Opens or creates `path`. An existing file must have been written with
+    // the same element size.
+    explicit MappedMemory(const std::string& path)
+    : fd_(::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644)) {
+        if(fd_ == -1) {
+            ADVANCED_VECTOR_THROW(std::system_error(errno, std::generic_category(), path));
+        }
+        ADVANCED_VECTOR_TRY {
+            struct stat st {};
+            if(::fstat(fd_, &st) != 0) {
+                ADVANCED_VECTOR_THROW(std::system_error(errno, std::generic_category(), path));
+            }
+            if(st.st_size != 0) {
+                OpenExisting(static_cast<size_t>(st.st_size));
+            }
+        } ADVANCED_VECTOR_CATCH_ALL {
+            Release();
+            ADVANCED_VECTOR_RETHROW;
+        }
+    }
+
+    MappedMemory(const MappedMemory&) = delete;
+    MappedMemory& operator=(const MappedMemory&) = delete;
+
+    MappedMemory(MappedMemory&& other) noexcept
+    : fd_(std::exchange(other.fd_, -1))
+    , map_(std::exchange(other.map_, nullptr))
+    , bytes_(std::exchange(other.bytes_, 0)) {
+    }
+
+    MappedMemory& operator=(MappedMemory&& other) noexcept {
+        if(this != &other) {
+            Release();
+            fd_ = std::exchange(other.fd_, -1);
+            map_ = std::exchange(other.map_, nullptr);
+            bytes_ = std::exchange(other.bytes_, 0);
+        }
+        return *this;
+    }
+
+    ~MappedMemory() {
+        Release();
+    }
+
+    void Swap(MappedMemory& other) noexcept {
+        std::swap(fd_, other.fd_);
+        std::swap(map_, other.map_);
+        std::swap(bytes_, other.bytes_);
+    }
+
+    [[nodiscard]] bool IsFileBacked() const noexcept {
+        return fd_ != -1;
+    }
+
+    [[nodiscard]] size_t Capacity() const noexcept {
+        return map_ != nullptr ? (bytes_ - detail::MAPPED_HEADER_SIZE) / sizeof(T) : 0;
+    }
+
+    [[nodiscard]] size_t Size() const noexcept {
+        return map_ != nullptr ? static_cast<size_t>(Header().size) : 0;
+    }
+
+    void SetSize(const size_t size) noexcept {
+        assert(size <= Capacity());
+        if(map_ != nullptr) {
+            Header().size = size;
+        }
+    }
+
+    const T* GetAddress() const noexcept {
+        return const_cast<MappedMemory&>(*this).GetAddress();
+    }
+
+    T* GetAddress() noexcept {
+        return map_ != nullptr ? GetMappedAddress() : nullptr;
+    }
+
+    // GetAddress() for a memory with Capacity() != 0, without the null check.
+    T* GetMappedAddress() noexcept {
+        assert(map_ != nullptr);
+        return reinterpret_cast<T*>(map_ + detail::MAPPED_HEADER_SIZE);
+    }
+
+    // Keeps the contents; throws and leaves the mapping intact on failure.
+    void Grow(const size_t new_capacity) {
+        if(new_capacity <= Capacity()) {
+            return;
+        }
+        if(new_capacity > (SIZE_MAX - detail::MAPPED_HEADER_SIZE - detail::PageSize()) / sizeof(T)) {
+            ADVANCED_VECTOR_THROW(std::length_error("MappedMemory is too large"));
+        }
+        const size_t page = detail::PageSize();
+        const size_t bytes = (detail::MAPPED_HEADER_SIZE + new_capacity * sizeof(T) + page - 1) / page * page;
+
+        if(fd_ != -1 && ::ftruncate(fd_, static_cast<off_t>(bytes)) != 0) {
+            ADVANCED_VECTOR_THROW(std::system_error(errno, std::generic_category(), "ftruncate"));
+        }
+        void* ptr = map_ == nullptr ? Map(bytes) : ::mremap(map_, bytes_, bytes, MREMAP_MAYMOVE);
+        if(ptr == MAP_FAILED) {
+            ADVANCED_VECTOR_THROW(std::bad_alloc());
+        }
+        AdviseHugePages(ptr, bytes);
+
+        const bool fresh = map_ == nullptr;
+        map_ = static_cast<unsigned char*>(ptr);
+        bytes_ = bytes;
+        if(fresh) {
+            Header() = detail::MappedHeader{detail::MAPPED_MAGIC, detail::MAPPED_VERSION, sizeof(T), 0};
+        }
+    }
+
+    // Writes dirty pages of a file-backed mapping to disk.
+    void Sync() {
+        if(fd_ != -1 && map_ != nullptr && ::msync(map_, bytes_, MS_SYNC) != 0) {
+            ADVANCED_VECTOR_THROW(std::system_error(errno, std::generic_category(), "msync"));
+        }
+    }
+
+private:
+    int fd_ = -1;
+    unsigned char* map_ = nullptr;
+    size_t bytes_ = 0;
+
+    detail::MappedHeader& Header() noexcept {
+        return *reinterpret_cast<detail::MappedHeader*>(map_);
+    }
+
+    const detail::MappedHeader& Header() const noexcept {
+        return *reinterpret_cast<const detail::MappedHeader*>(map_);
+    }
+
+    void* Map(const size_t bytes) noexcept {
+        return fd_ != -1 ? ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0)
+                         : ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+
+    void AdviseHugePages([[maybe_unused]] void* ptr, [[maybe_unused]] const size_t bytes) noexcept {
+#ifdef MADV_HUGEPAGE
+        if(fd_ == -1) {
+            ::madvise(ptr, bytes, MADV_HUGEPAGE);
+        }
+#endif
+    }
+
+    void OpenExisting(const size_t bytes) {
+        if(bytes < detail::MAPPED_HEADER_SIZE) {
+            ADVANCED_VECTOR_THROW(std::runtime_error("MappedMemory: file is too small"));
+        }
+        void* ptr = Map(bytes);
+        if(ptr == MAP_FAILED) {
+            ADVANCED_VECTOR_THROW(std::system_error(errno, std::generic_category(), "mmap"));
+        }
+        map_ = static_cast<unsigned char*>(ptr);
+        bytes_ = bytes;
+        const detail::MappedHeader& header = Header();
+        if(header.magic != detail::MAPPED_MAGIC || header.version != detail::MAPPED_VERSION) {
+            ADVANCED_VECTOR_THROW(std::runtime_error("MappedMemory: not a vector file"));
+        }
+        if(header.elem_size != sizeof(T)) {
+            ADVANCED_VECTOR_THROW(std::runtime_error("MappedMemory: element size mismatch"));
+        }
+        if(header.size > Capacity()) {
+            ADVANCED_VECTOR_THROW(std::runtime_error("MappedMemory: corrupted size"));
+        }
+    }
+
+    void Release() noexcept {
+        if(map_ != nullptr) {
+            ::munmap(map_, bytes_);
+            map_ = nullptr;
+            bytes_ = 0;
+        }
+        if(fd_ != -1) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+};
+
+// Vector of trivially copyable T in MappedMemory. With a path it persists its
+// elements in the file and picks them up again when reopened, so T must not
+// hold pointers that would dangle across processes.
+template<typename T, typename GrowthPolicy = DoublingGrowthPolicy>
+class MappedVector {
+public:
+    using value_type = T;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    MappedVector() = default;
+
+    explicit MappedVector(const std::string& path)
+    : data_(path) {
+    }
+
+    MappedVector(MappedVector&& other) noexcept = default;
+    MappedVector& operator=(MappedVector&& other) noexcept = default;
+
+    iterator begin() noexcept {
+        return data_.GetAddress();
+    }
+
+    const_iterator cbegin() const noexcept {
+        return data_.GetAddress();
+    }
+
+    const_iterator begin() const noexcept {
+        return cbegin();
+    }
+
+    iterator end() noexcept {
+        return data_.GetAddress() + Size();
+    }
+
+    const_iterator cend() const noexcept {
+        return data_.GetAddress() + Size();
+    }
+
+    const_iterator end() const noexcept {
+        return cend();
+    }
+
+    [[nodiscard]] size_t Capacity() const noexcept {
+        return data_.Capacity();
+    }
+
+    [[nodiscard]] size_t Size() const noexcept {
+        return data_.Size();
+    }
+
+    [[nodiscard]] bool IsFileBacked() const noexcept {
+        return data_.IsFileBacked();
+    }
+
+    void Reserve(const size_t new_capacity) {
+        data_.Grow(new_capacity);
+    }
+
+    void Resize(const size_t new_size) {
+        const size_t size = Size();
+        if(new_size > size) {
+            Reserve(new_size);
+            std::uninitialized_value_construct_n(data_.GetAddress() + size, new_size - size);
+        }
+        data_.SetSize(new_size);
+    }
+
+    template<typename Type>
+    void PushBack(Type&& elem) {
+        EmplaceBack(std::forward<Type>(elem));
+    }
+
+    void PopBack() noexcept {
+        assert(Size() > 0);
+        data_.SetSize(Size() - 1);
+    }
+
+    template<typename... Args>
+    T& EmplaceBack(Args&&... args) {
+        return *Emplace(cend(), std::forward<Args>(args)...);
+    }
+
+    // The value is built before growing, since growth may move the mapping
+    // that `args` point into.
+    template<typename... Args>
+    iterator Emplace(const_iterator pos, Args&&... args) {
+        const size_t position = pos - cbegin();
+        const size_t size = Size();
+        T elem(std::forward<Args>(args)...);
+        if(size == Capacity()) {
+            data_.Grow(std::max(size + 1, GrowthPolicy::NextCapacity(Capacity(), size + 1, sizeof(T))));
+        }
+        detail::EmplaceInSpare(data_.GetMappedAddress(), size, position, std::move(elem));
+        data_.SetSize(size + 1);
+        return begin() + position;
+    }
+
+    iterator Insert(const_iterator pos, const T& elem) {
+        return Emplace(pos, elem);
+    }
+
+    iterator Insert(const_iterator pos, T&& elem) {
+        return Emplace(pos, std::move(elem));
+    }
+
+    iterator Erase(const_iterator pos) {
+        assert(pos < end() && pos >= begin());
+        const size_t position = pos - begin();
+        detail::EraseAt(data_.GetMappedAddress(), Size(), position);
+        data_.SetSize(Size() - 1);
+        return begin() + position;
+    }
+
+    void Swap(MappedVector& other) noexcept {
+        data_.Swap(other.data_);
+    }
+
+    void Sync() {
+        data_.Sync();
+    }
+
+    const T& operator[](const size_t index) const noexcept {
+        return const_cast<MappedVector&>(*this)[index];
+    }
+
+    T& operator[](const size_t index) noexcept {
+        assert(index < Size());
+        return data_.GetAddress()[index];
+    }
+
+private:
+    MappedMemory<T> data_;
+};
@@ -0,0 +1,457 @@
+#pragma once
+
+#include "vector.h"
+
+// Vector that stores its elements in fixed-size RawMemory blocks. Growth
+// appends a block and never relocates elements, so pointers and references
+// stay valid and the old and new buffers are never resident at the same time.
+// Only the table of blocks is reallocated, and it holds one RawMemory per
+// BlockSize elements.
+template<typename T, size_t BlockSize = std::max<size_t>(4096 / sizeof(T), 16), typename Allocator = std::allocator<T>>
+class SegmentedVector {
+    static_assert(BlockSize > 0, "SegmentedVector needs room for at least one element per block");
+
+    using AllocTraits = std::allocator_traits<Allocator>;
+    using Block = RawMemory<T, Allocator>;
+    // The blocks followed by an empty sentinel that iterators step onto past
+    // the last block; empty while no block is allocated.
+    using Table = Vector<Block, typename AllocTraits::template rebind_alloc<Block>>;
+
+public:
+    template<bool IsConst>
+    class BasicIterator {
+        friend class SegmentedVector;
+        using BlockPtr = std::conditional_t<IsConst, const Block*, Block*>;
+
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<IsConst, const T*, T*>;
+        using reference = std::conditional_t<IsConst, const T&, T&>;
+
+        BasicIterator() = default;
+
+        template<bool OtherConst, typename = std::enable_if_t<IsConst && !OtherConst>>
+        BasicIterator(const BasicIterator<OtherConst>& other) noexcept
+        : block_(other.block_)
+        , first_(other.first_)
+        , cur_(other.cur_) {
+        }
+
+        reference operator*() const noexcept {
+            return *cur_;
+        }
+
+        pointer operator->() const noexcept {
+            return cur_;
+        }
+
+        reference operator[](const difference_type offset) const noexcept {
+            return *(*this + offset);
+        }
+
+        BasicIterator& operator++() noexcept {
+            if(++cur_ == first_ + BlockSize) {
+                ++block_;
+                first_ = cur_ = block_->GetAddress();
+            }
+            return *this;
+        }
+
+        BasicIterator operator++(int) noexcept {
+            BasicIterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        BasicIterator& operator--() noexcept {
+            if(cur_ == first_) {
+                --block_;
+                first_ = block_->GetAddress();
+                cur_ = first_ + BlockSize;
+            }
+            --cur_;
+            return *this;
+        }
+
+        BasicIterator operator--(int) noexcept {
+            BasicIterator old = *this;
+            --*this;
+            return old;
+        }
+
+        BasicIterator& operator+=(const difference_type offset) noexcept {
+            const difference_type block_size = static_cast<difference_type>(BlockSize);
+            const difference_type position = (cur_ - first_) + offset;
+            if(position >= 0 && position < block_size) {
+                cur_ += offset;
+            } else {
+                const difference_type blocks = position >= 0 ? position / block_size
+                                                             : -((-position - 1) / block_size) - 1;
+                block_ += blocks;
+                first_ = block_->GetAddress();
+                cur_ = first_ + (position - blocks * block_size);
+            }
+            return *this;
+        }
+
+        BasicIterator& operator-=(const difference_type offset) noexcept {
+            return *this += -offset;
+        }
+
+        friend BasicIterator operator+(BasicIterator it, const difference_type offset) noexcept {
+            return it += offset;
+        }
+
+        friend BasicIterator operator+(const difference_type offset, BasicIterator it) noexcept {
+            return it += offset;
+        }
+
+        friend BasicIterator operator-(BasicIterator it, const difference_type offset) noexcept {
+            return it -= offset;
+        }
+
+        friend difference_type operator-(const BasicIterator& lhs, const BasicIterator& rhs) noexcept {
+            return (lhs.block_ - rhs.block_) * static_cast<difference_type>(BlockSize)
+                   + (lhs.cur_ - lhs.first_) - (rhs.cur_ - rhs.first_);
+        }
+
+        friend bool operator==(const BasicIterator& lhs, const BasicIterator& rhs) noexcept {
+            return lhs.cur_ == rhs.cur_;
+        }
+
+        friend bool operator!=(const BasicIterator& lhs, const BasicIterator& rhs) noexcept {
+            return lhs.cur_ != rhs.cur_;
+        }
+
+        friend bool operator<(const BasicIterator& lhs, const BasicIterator& rhs) noexcept {
+            return lhs.block_ < rhs.block_ || (lhs.block_ == rhs.block_ && lhs.cur_ < rhs.cur_);
+        }
+
+        friend bool operator>(const BasicIterator& lhs, const BasicIterator& rhs) noexcept {
+            return rhs < lhs;
+        }
+
+        friend bool operator<=(const BasicIterator& lhs, const BasicIterator& rhs) noexcept {
+            return !(rhs < lhs);
+        }
+
+        friend bool operator>=(const BasicIterator& lhs, const BasicIterator& rhs) noexcept {
+            return !(lhs < rhs);
+        }
+
+    private:
+        BlockPtr block_ = nullptr;
+        pointer first_ = nullptr;
+        pointer cur_ = nullptr;
+
+        BasicIterator(BlockPtr block, const size_t offset) noexcept
+        : block_(block)
+        , first_(block->GetAddress())
+        , cur_(first_ + offset) {
+        }
+
+        template<bool>
+        friend class BasicIterator;
+    };
+
+    using value_type = T;
+    using allocator_type = Allocator;
+    using iterator = BasicIterator<false>;
+    using const_iterator = BasicIterator<true>;
+
+    SegmentedVector() = default;
+
+    explicit SegmentedVector(const Allocator& alloc) noexcept
+    : alloc_(alloc) {
+    }
+
+    explicit SegmentedVector(const size_t count, const Allocator& alloc = Allocator())
+    : alloc_(alloc) {
+        Reserve(count);
+        ValueConstructBack(count);
+    }
+
+    SegmentedVector(const SegmentedVector& other)
+    : alloc_(AllocTraits::select_on_container_copy_construction(other.alloc_)) {
+        Reserve(other.size_);
+        ConstructBackN(other.begin(), other.size_);
+    }
+
+    SegmentedVector(SegmentedVector&& other) noexcept
+    : alloc_(std::move(other.alloc_))
+    , table_(std::move(other.table_))
+    , size_(std::exchange(other.size_, 0)) {
+    }
+
+    ~SegmentedVector() {
+        DestroyRange(0, size_);
+    }
+
+    [[nodiscard]] allocator_type GetAllocator() const noexcept {
+        return alloc_;
+    }
+
+    iterator begin() noexcept {
+        return MakeIterator(0);
+    }
+
+    const_iterator cbegin() const noexcept {
+        return const_cast<SegmentedVector&>(*this).MakeIterator(0);
+    }
+
+    const_iterator begin() const noexcept {
+        return cbegin();
+    }
+
+    iterator end() noexcept {
+        return MakeIterator(size_);
+    }
+
+    const_iterator cend() const noexcept {
+        return const_cast<SegmentedVector&>(*this).MakeIterator(size_);
+    }
+
+    const_iterator end() const noexcept {
+        return cend();
+    }
+
+    [[nodiscard]] size_t Capacity() const noexcept {
+        return BlockCount() * BlockSize;
+    }
+
+    [[nodiscard]] size_t Size() const noexcept {
+        return size_;
+    }
+
+    [[nodiscard]] size_t BlockCount() const noexcept {
+        return table_.Size() != 0 ? table_.Size() - 1 : 0;
+    }
+
+    void Reserve(const size_t new_capacity) {
+        if(new_capacity <= Capacity()) {
+            return;
+        }
+        const size_t blocks = (new_capacity + BlockSize - 1) / BlockSize;
+        table_.Reserve(blocks + 1);
+        while(BlockCount() < blocks) {
+            AddBlock();
+        }
+    }
+
+    // Frees the blocks past the last element.
+    void ShrinkToFit() noexcept {
+        const size_t used_blocks = (size_ + BlockSize - 1) / BlockSize;
+        while(BlockCount() > used_blocks) {
+            table_.Erase(table_.cend() - 2);
+        }
+    }
+
+    void Resize(const size_t new_size) {
+        if(new_size < size_) {
+            DestroyRange(new_size, size_);
+            size_ = new_size;
+        } else if(new_size > size_) {
+            Reserve(new_size);
+            ValueConstructBack(new_size - size_);
+        }
+    }
+
+    template<typename Type>
+    void PushBack(Type&& elem) {
+        EmplaceBack(std::forward<Type>(elem));
+    }
+
+    void PopBack() noexcept {
+        assert(size_ > 0);
+        std::destroy_at(Slot(size_ - 1));
+        --size_;
+    }
+
+    template<typename... Args>
+    T& EmplaceBack(Args&&... args) {
+        if(size_ == Capacity()) {
+            AddBlock();
+        }
+        T* elem = new (Slot(size_)) T(std::forward<Args>(args)...);
+        ++size_;
+        return *elem;
+    }
+
+    // Elements after `pos` are shifted by move assignment, so they keep their
+    // addresses but not their values; nothing is relocated.
+    template<typename... Args>
+    iterator Emplace(const_iterator pos, Args&&... args) {
+        const size_t position = pos - cbegin();
+        if(position == size_) {
+            EmplaceBack(std::forward<Args>(args)...);
+        } else {
+            T temp(std::forward<Args>(args)...);
+            EmplaceBack(std::move((*this)[size_ - 1]));
+            std::move_backward(begin() + position, end() - 2, end() - 1);
+            (*this)[position] = std::move(temp);
+        }
+        return begin() + position;
+    }
+
+    iterator Insert(const_iterator pos, const T& elem) {
+        return Emplace(pos, elem);
+    }
+
+    iterator Insert(const_iterator pos, T&& elem) {
+        return Emplace(pos, std::move(elem));
+    }
+
+    iterator Erase(const_iterator pos) {
+        assert(pos < cend() && pos >= cbegin());
+        const size_t position = pos - cbegin();
+        std::move(begin() + position + 1, end(), begin() + position);
+        PopBack();
+        return begin() + position;
+    }
+
+    void Swap(SegmentedVector& other) noexcept {
+        if constexpr (AllocTraits::propagate_on_container_swap::value) {
+            using std::swap;
+            swap(alloc_, other.alloc_);
+        } else {
+            assert(alloc_ == other.alloc_);
+        }
+        table_.Swap(other.table_);
+        std::swap(size_, other.size_);
+    }
+
+    const T& operator[](const size_t index) const noexcept {
+        return const_cast<SegmentedVector&>(*this)[index];
+    }
+
+    T& operator[](const size_t index) noexcept {
+        assert(index < size_);
+        return *Slot(index);
+    }
+
+    SegmentedVector& operator=(const SegmentedVector& other) {
+        if(this != &other) {
+            if constexpr (AllocTraits::propagate_on_container_copy_assignment::value) {
+                if(alloc_ != other.alloc_) {
+                    Clear();
+                    table_ = Table();
+                }
+                alloc_ = other.alloc_;
+            }
+            AssignN(other.begin(), other.size_);
+        }
+        return *this;
+    }
+
+    SegmentedVector& operator=(SegmentedVector&& other) noexcept(AllocTraits::propagate_on_container_move_assignment::value
+                                                                 || AllocTraits::is_always_equal::value) {
+        if(this != &other) {
+            if(AllocTraits::propagate_on_container_move_assignment::value || alloc_ == other.alloc_) {
+                Clear();
+                if constexpr (AllocTraits::propagate_on_container_move_assignment::value) {
+                    alloc_ = std::move(other.alloc_);
+                }
+                table_ = std::move(other.table_);
+                size_ = std::exchange(other.size_, 0);
+            } else {
+                AssignN(std::make_move_iterator(other.begin()), other.size_);
+            }
+        }
+        return *this;
+    }
+
+private:
+    ADVANCED_VECTOR_NO_UNIQUE_ADDRESS Allocator alloc_;
+    Table table_;
+    size_t size_ = 0;
+
+    T* Slot(const size_t index) noexcept {
+        return table_[index / BlockSize] + index % BlockSize;
+    }
+
+    iterator MakeIterator(const size_t index) noexcept {
+        if(table_.Size() == 0) {
+            return iterator();
+        }
+        return iterator(table_.Data() + index / BlockSize, index % BlockSize);
+    }
+
+    void AddBlock() {
+        Block block(BlockSize, alloc_);
+        if(table_.Size() == 0) {
+            table_.EmplaceBack(alloc_);
+        }
+        table_.EmplaceBack(std::move(block));
+        const size_t last = table_.Size() - 1;
+        table_[last - 1].Swap(table_[last]);
+    }
+
+    // Calls op(first, count) for every block-contiguous piece of [from, to).
+    template<typename Op>
+    void ForEachRange(size_t from, const size_t to, Op op) {
+        while(from != to) {
+            const size_t offset = from % BlockSize;
+            const size_t count = std::min(BlockSize - offset, to - from);
+            op(Slot(from), count);
+            from += count;
+        }
+    }
+
+    void DestroyRange(const size_t from, const size_t to) noexcept {
+        ForEachRange(from, to, [](T* first, const size_t count) {
+            std::destroy_n(first, count);
+        });
+    }
+
+    void Clear() noexcept {
+        DestroyRange(0, size_);
+        size_ = 0;
+    }
+
+    // Both construct at the end within the reserved capacity and leave the
+    // vector unchanged if a constructor throws.
+    void ValueConstructBack(const size_t count) {
+        const size_t old_size = size_;
+        ADVANCED_VECTOR_TRY {
+            ForEachRange(size_, size_ + count, [this](T* first, const size_t n) {
+                std::uninitialized_value_construct_n(first, n);
+                size_ += n;
+            });
+        } ADVANCED_VECTOR_CATCH_ALL {
+            DestroyRange(old_size, size_);
+            size_ = old_size;
+            ADVANCED_VECTOR_RETHROW;
+        }
+    }
+
+    template<typename RandomIt>
+    void ConstructBackN(RandomIt first, const size_t count) {
+        const size_t old_size = size_;
+        ADVANCED_VECTOR_TRY {
+            ForEachRange(size_, size_ + count, [this, &first](T* dest, const size_t n) {
+                std::uninitialized_copy_n(first, n, dest);
+                first += n;
+                size_ += n;
+            });
+        } ADVANCED_VECTOR_CATCH_ALL {
+            DestroyRange(old_size, size_);
+            size_ = old_size;
+            ADVANCED_VECTOR_RETHROW;
+        }
+    }
+
+    template<typename RandomIt>
+    void AssignN(RandomIt first, const size_t count) {
+        Reserve(count);
+        if(size_ < count) {
+            std::copy_n(first, size_, begin());
+            ConstructBackN(first + size_, count - size_);
+        } else {
+            std::copy_n(first, count, begin());
+            DestroyRange(count, size_);
+            size_ = count;
+        }
+    }
+};
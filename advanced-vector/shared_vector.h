@@ -0,0 +1,193 @@
+#pragma once
+
+#include "vector.h"
+
+namespace detail {
+
+template<typename Vec>
+struct SharedBlock {
+    explicit SharedBlock(Vec&& source) noexcept
+    : vector(std::move(source)) {
+    }
+
+    explicit SharedBlock(const Vec& source)
+    : vector(source) {
+    }
+
+    std::atomic<size_t> refs{1};
+    Vec vector;
+};
+
+}  // namespace detail
+
+// Copy-on-write handle to a reference-counted Vector. Copies share the
+// elements and only bump an atomic counter; the first mutation through a
+// shared handle copies the elements into a block of its own. Like
+// std::shared_ptr, distinct handles may be used from different threads
+// without locking, but a single handle must not be mutated concurrently.
+template<typename T, typename Allocator = std::allocator<T>, typename GrowthPolicy = DoublingGrowthPolicy,
+         typename Instrumentation = NoInstrumentation>
+class SharedVector {
+public:
+    using VectorType = Vector<T, Allocator, GrowthPolicy, Instrumentation>;
+    using value_type = T;
+    using const_iterator = typename VectorType::const_iterator;
+
+    SharedVector() = default;
+
+    // Takes over the buffer of `vector` without copying the elements.
+    explicit SharedVector(VectorType&& vector)
+    : block_(MakeBlock(std::move(vector))) {
+    }
+
+    SharedVector(const SharedVector& other) noexcept
+    : block_(other.block_) {
+        if(block_ != nullptr) {
+            block_->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    SharedVector(SharedVector&& other) noexcept
+    : block_(std::exchange(other.block_, nullptr)) {
+    }
+
+    ~SharedVector() {
+        Release();
+    }
+
+    SharedVector& operator=(const SharedVector& other) noexcept {
+        SharedVector(other).Swap(*this);
+        return *this;
+    }
+
+    SharedVector& operator=(SharedVector&& other) noexcept {
+        SharedVector(std::move(other)).Swap(*this);
+        return *this;
+    }
+
+    void Swap(SharedVector& other) noexcept {
+        std::swap(block_, other.block_);
+    }
+
+    [[nodiscard]] const VectorType& Get() const noexcept {
+        static const VectorType empty;
+        return block_ != nullptr ? block_->vector : empty;
+    }
+
+    const_iterator begin() const noexcept {
+        return Get().begin();
+    }
+
+    const_iterator cbegin() const noexcept {
+        return Get().cbegin();
+    }
+
+    const_iterator end() const noexcept {
+        return Get().end();
+    }
+
+    const_iterator cend() const noexcept {
+        return Get().cend();
+    }
+
+    [[nodiscard]] size_t Size() const noexcept {
+        return Get().Size();
+    }
+
+    [[nodiscard]] const T* Data() const noexcept {
+        return Get().Data();
+    }
+
+    const T& operator[](const size_t index) const noexcept {
+        return Get()[index];
+    }
+
+    // Handles sharing the elements, this one included; 0 for an empty
+    // default-constructed handle.
+    [[nodiscard]] size_t UseCount() const noexcept {
+        return block_ != nullptr ? block_->refs.load(std::memory_order_acquire) : 0;
+    }
+
+    [[nodiscard]] bool IsUnique() const noexcept {
+        return UseCount() == 1;
+    }
+
+    // Gives write access to the elements, copying them first if they are
+    // shared. The reference is valid until the handle is copied or assigned.
+    VectorType& Mutate() {
+        if(block_ == nullptr) {
+            block_ = MakeBlock(VectorType());
+        } else if(!IsUnique()) {
+            Block* copy = MakeBlock(block_->vector);
+            Release();
+            block_ = copy;
+        }
+        return block_->vector;
+    }
+
+    template<typename Type>
+    void PushBack(Type&& elem) {
+        Mutate().PushBack(std::forward<Type>(elem));
+    }
+
+    template<typename... Args>
+    T& EmplaceBack(Args&&... args) {
+        return Mutate().EmplaceBack(std::forward<Args>(args)...);
+    }
+
+    void PopBack() {
+        Mutate().PopBack();
+    }
+
+    void Resize(const size_t new_size) {
+        Mutate().Resize(new_size);
+    }
+
+    // Turns the handle back into a plain Vector, moving the elements out if
+    // no other handle shares them and copying them otherwise.
+    [[nodiscard]] VectorType Thaw() && {
+        if(block_ == nullptr) {
+            return VectorType();
+        }
+        VectorType result = IsUnique() ? std::move(block_->vector) : VectorType(block_->vector);
+        Release();
+        return result;
+    }
+
+private:
+    using Block = detail::SharedBlock<VectorType>;
+    using BlockAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Block>;
+    using BlockTraits = std::allocator_traits<BlockAllocator>;
+
+    Block* block_ = nullptr;
+
+    template<typename Vec>
+    static Block* MakeBlock(Vec&& vector) {
+        BlockAllocator alloc(vector.GetAllocator());
+        Block* block = BlockTraits::allocate(alloc, 1);
+        ADVANCED_VECTOR_TRY {
+            BlockTraits::construct(alloc, block, std::forward<Vec>(vector));
+        } ADVANCED_VECTOR_CATCH_ALL {
+            BlockTraits::deallocate(alloc, block, 1);
+            ADVANCED_VECTOR_RETHROW;
+        }
+        return block;
+    }
+
+    void Release() noexcept {
+        Block* block = std::exchange(block_, nullptr);
+        if(block != nullptr && block->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            BlockAllocator alloc(block->vector.GetAllocator());
+            BlockTraits::destroy(alloc, block);
+            BlockTraits::deallocate(alloc, block, 1);
+        }
+    }
+};
+
+// Turns `vector` into an immutable snapshot that can be handed to any number
+// of readers in O(1) per copy. The elements are not copied.
+template<typename T, typename Allocator, typename GrowthPolicy, typename Instrumentation>
+SharedVector<T, Allocator, GrowthPolicy, Instrumentation> Freeze(
+    Vector<T, Allocator, GrowthPolicy, Instrumentation>&& vector) {
+    return SharedVector<T, Allocator, GrowthPolicy, Instrumentation>(std::move(vector));
+}
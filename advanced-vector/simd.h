@@ -0,0 +1,403 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Kernels behind the search and reduction members of Vector. They are
+// written once with the GCC/Clang vector extensions and compiled for several
+// instruction sets; the widest one the CPU supports is picked at run time.
+// Other compilers, and element types without a vector lane type, get plain
+// loops.
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__ARM_NEON))
+#define ADVANCED_VECTOR_SIMD
+#endif
+
+#if defined(ADVANCED_VECTOR_SIMD) && defined(__x86_64__)
+#define ADVANCED_VECTOR_SIMD_X86
+#endif
+
+enum class SimdLevel {
+    SCALAR,
+    SSE2,
+    NEON,
+    AVX2,
+    AVX512,
+};
+
+namespace detail::simd {
+
+inline SimdLevel DetectLevel() noexcept {
+#if defined(ADVANCED_VECTOR_SIMD_X86)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+        return SimdLevel::AVX512;
+    }
+    if(__builtin_cpu_supports("avx2")) {
+        return SimdLevel::AVX2;
+    }
+    return SimdLevel::SSE2;
+#elif defined(ADVANCED_VECTOR_SIMD)
+    return SimdLevel::NEON;
+#else
+    return SimdLevel::SCALAR;
+#endif
+}
+
+inline const SimdLevel SUPPORTED_LEVEL = DetectLevel();
+inline std::atomic<SimdLevel> active_level{SUPPORTED_LEVEL};
+
+}  // namespace detail::simd
+
+// Instruction set the kernels currently use.
+inline SimdLevel GetSimdLevel() noexcept {
+    return detail::simd::active_level.load(std::memory_order_relaxed);
+}
+
+// Restricts the kernels to `level`, e.g. to compare against the scalar path.
+// A level the CPU does not support selects the detected one instead.
+inline void SetSimdLevel(const SimdLevel level) noexcept {
+    using detail::simd::SUPPORTED_LEVEL;
+    const bool supported = level == SimdLevel::SCALAR || level == SUPPORTED_LEVEL
+        || (level != SimdLevel::NEON && SUPPORTED_LEVEL != SimdLevel::NEON && level <= SUPPORTED_LEVEL);
+    detail::simd::active_level.store(supported ? level : SUPPORTED_LEVEL, std::memory_order_relaxed);
+}
+
+namespace detail::simd {
+
+template<size_t Size, bool Signed>
+struct IntOfSize;
+
+template<> struct IntOfSize<1, true> { using type = int8_t; };
+template<> struct IntOfSize<2, true> { using type = int16_t; };
+template<> struct IntOfSize<4, true> { using type = int32_t; };
+template<> struct IntOfSize<8, true> { using type = int64_t; };
+template<> struct IntOfSize<1, false> { using type = uint8_t; };
+template<> struct IntOfSize<2, false> { using type = uint16_t; };
+template<> struct IntOfSize<4, false> { using type = uint32_t; };
+template<> struct IntOfSize<8, false> { using type = uint64_t; };
+
+// Vector lane type that compares and orders like T, or void when T has none.
+template<typename T, typename = void>
+struct Lane {
+    using type = void;
+};
+
+template<typename T>
+struct Lane<T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>>> {
+    using type = typename IntOfSize<sizeof(T), std::is_signed_v<T>>::type;
+};
+
+template<>
+struct Lane<float> {
+    using type = float;
+};
+
+template<>
+struct Lane<double> {
+    using type = double;
+};
+
+template<typename T>
+using LaneT = typename Lane<T>::type;
+
+template<typename T>
+inline constexpr bool HasLaneV = !std::is_void_v<LaneT<T>>;
+
+#ifdef ADVANCED_VECTOR_SIMD
+
+// The kernels are always inlined into the per-target wrappers below, so each
+// copy is compiled for that wrapper's instruction set.
+#define ADVANCED_VECTOR_KERNEL __attribute__((always_inline)) inline
+
+template<typename L, size_t Width>
+struct Vec {
+    typedef L Type __attribute__((vector_size(Width)));
+    typedef typename IntOfSize<sizeof(L), false>::type Counter __attribute__((vector_size(Width)));
+
+    static constexpr size_t LANES = Width / sizeof(L);
+
+    // Vectors are passed by reference: by value they would change the ABI
+    // between the targets.
+    template<typename T>
+    ADVANCED_VECTOR_KERNEL static void Load(Type& out, const T* data) noexcept {
+        std::memcpy(&out, data, Width);
+    }
+
+    template<typename Mask>
+    ADVANCED_VECTOR_KERNEL static bool Any(const Mask& mask) noexcept {
+        uint64_t words[Width / 8];
+        std::memcpy(words, &mask, Width);
+        uint64_t any = 0;
+        for(const uint64_t word : words) {
+            any |= word;
+        }
+        return any != 0;
+    }
+};
+
+template<size_t Width, typename T>
+ADVANCED_VECTOR_KERNEL size_t FindKernel(const T* data, const size_t size, const T value) noexcept {
+    using V = Vec<LaneT<T>, Width>;
+    const typename V::Type needle = typename V::Type{} + static_cast<LaneT<T>>(value);
+    size_t i = 0;
+    for(; i + V::LANES <= size; i += V::LANES) {
+        typename V::Type chunk;
+        V::Load(chunk, data + i);
+        if(V::Any(chunk == needle)) {
+            break;
+        }
+    }
+    for(; i != size && !(data[i] == value); ++i) {
+    }
+    return i;
+}
+
+// Rounds after which a lane counter as wide as T may wrap.
+template<typename T>
+constexpr size_t CounterFlushPeriod() noexcept {
+    if constexpr (sizeof(T) < sizeof(uint64_t)) {
+        return static_cast<size_t>((uint64_t{1} << (8 * sizeof(T))) - 1);
+    } else {
+        return SIZE_MAX;
+    }
+}
+
+template<size_t Width, typename T>
+ADVANCED_VECTOR_KERNEL size_t CountKernel(const T* data, const size_t size, const T value) noexcept {
+    using V = Vec<LaneT<T>, Width>;
+    // Counters narrower than 64 bits are flushed before they can wrap.
+    constexpr size_t FLUSH_EVERY = CounterFlushPeriod<T>();
+    const typename V::Type needle = typename V::Type{} + static_cast<LaneT<T>>(value);
+    size_t count = 0;
+    size_t i = 0;
+    while(i + V::LANES <= size) {
+        typename V::Counter counters{};
+        for(size_t round = 0; round != FLUSH_EVERY && i + V::LANES <= size; ++round, i += V::LANES) {
+            typename V::Type chunk;
+            V::Load(chunk, data + i);
+            counters -= (typename V::Counter)(chunk == needle);
+        }
+        for(size_t lane = 0; lane != V::LANES; ++lane) {
+            count += counters[lane];
+        }
+    }
+    for(; i != size; ++i) {
+        count += data[i] == value;
+    }
+    return count;
+}
+
+template<size_t Width, typename T>
+ADVANCED_VECTOR_KERNEL size_t MismatchKernel(const T* lhs, const T* rhs, const size_t size) noexcept {
+    using V = Vec<LaneT<T>, Width>;
+    size_t i = 0;
+    for(; i + V::LANES <= size; i += V::LANES) {
+        typename V::Type left;
+        typename V::Type right;
+        V::Load(left, lhs + i);
+        V::Load(right, rhs + i);
+        if(V::Any(left != right)) {
+            break;
+        }
+    }
+    for(; i != size && lhs[i] == rhs[i]; ++i) {
+    }
+    return i;
+}
+
+// Every lane starts from data[0], so elements that never compare less (NaN)
+// are skipped exactly as in a sequential scan.
+template<size_t Width, bool Max, typename T>
+ADVANCED_VECTOR_KERNEL T MinMaxKernel(const T* data, const size_t size) noexcept {
+    using V = Vec<LaneT<T>, Width>;
+    using L = LaneT<T>;
+    typename V::Type best = typename V::Type{} + static_cast<L>(data[0]);
+    size_t i = 0;
+    for(; i + V::LANES <= size; i += V::LANES) {
+        typename V::Type chunk;
+        V::Load(chunk, data + i);
+        if constexpr (Max) {
+            best = best < chunk ? chunk : best;
+        } else {
+            best = chunk < best ? chunk : best;
+        }
+    }
+    L result = best[0];
+    for(size_t lane = 1; lane != V::LANES; ++lane) {
+        result = Max ? (result < best[lane] ? best[lane] : result) : (best[lane] < result ? best[lane] : result);
+    }
+    for(; i != size; ++i) {
+        const L elem = static_cast<L>(data[i]);
+        result = Max ? (result < elem ? elem : result) : (elem < result ? elem : result);
+    }
+    return static_cast<T>(result);
+}
+
+// Four independent accumulators; integers are summed with unsigned lanes, so
+// they wrap like repeated T addition instead of overflowing.
+template<size_t Width, typename T>
+ADVANCED_VECTOR_KERNEL T SumKernel(const T* data, const size_t size) noexcept {
+    using L = std::conditional_t<std::is_integral_v<T>, typename IntOfSize<sizeof(T), false>::type, LaneT<T>>;
+    using V = Vec<L, Width>;
+    typename V::Type acc[4] = {};
+    size_t i = 0;
+    for(; i + 4 * V::LANES <= size; i += 4 * V::LANES) {
+        for(size_t k = 0; k != 4; ++k) {
+            typename V::Type chunk;
+            V::Load(chunk, data + i + k * V::LANES);
+            acc[k] += chunk;
+        }
+    }
+    for(; i + V::LANES <= size; i += V::LANES) {
+        typename V::Type chunk;
+        V::Load(chunk, data + i);
+        acc[0] += chunk;
+    }
+    const typename V::Type total = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+    L result = 0;
+    for(size_t lane = 0; lane != V::LANES; ++lane) {
+        result += total[lane];
+    }
+    for(; i != size; ++i) {
+        result += static_cast<L>(data[i]);
+    }
+    return static_cast<T>(result);
+}
+
+#undef ADVANCED_VECTOR_KERNEL
+
+#define ADVANCED_VECTOR_SIMD_TARGET(Name, Attribute, Width)                                  \
+    struct Name {                                                                            \
+        template<typename T>                                                                 \
+        Attribute static size_t Find(const T* data, const size_t size, const T value) noexcept { \
+            return FindKernel<Width>(data, size, value);                                     \
+        }                                                                                    \
+        template<typename T>                                                                 \
+        Attribute static size_t Count(const T* data, const size_t size, const T value) noexcept { \
+            return CountKernel<Width>(data, size, value);                                    \
+        }                                                                                    \
+        template<typename T>                                                                 \
+        Attribute static size_t Mismatch(const T* lhs, const T* rhs, const size_t size) noexcept { \
+            return MismatchKernel<Width>(lhs, rhs, size);                                    \
+        }                                                                                    \
+        template<bool Max, typename T>                                                       \
+        Attribute static T MinMax(const T* data, const size_t size) noexcept {               \
+            return MinMaxKernel<Width, Max>(data, size);                                     \
+        }                                                                                    \
+        template<typename T>                                                                 \
+        Attribute static T Sum(const T* data, const size_t size) noexcept {                  \
+            return SumKernel<Width>(data, size);                                             \
+        }                                                                                    \
+    }
+
+// SSE2 on x86-64, NEON on AArch64: both are part of the base ABI.
+ADVANCED_VECTOR_SIMD_TARGET(BaseTarget, , 16);
+#ifdef ADVANCED_VECTOR_SIMD_X86
+ADVANCED_VECTOR_SIMD_TARGET(Avx2Target, __attribute__((target("avx2"))), 32);
+ADVANCED_VECTOR_SIMD_TARGET(Avx512Target, __attribute__((target("avx512f,avx512bw"))), 64);
+#endif
+
+#undef ADVANCED_VECTOR_SIMD_TARGET
+
+// Calls op(Target{}) with the widest target allowed by GetSimdLevel(), or
+// returns false when only the scalar path is allowed.
+template<typename Op>
+bool Dispatch(Op&& op) {
+    switch(GetSimdLevel()) {
+#ifdef ADVANCED_VECTOR_SIMD_X86
+    case SimdLevel::AVX512:
+        op(Avx512Target{});
+        return true;
+    case SimdLevel::AVX2:
+        op(Avx2Target{});
+        return true;
+#endif
+    case SimdLevel::SCALAR:
+        return false;
+    default:
+        op(BaseTarget{});
+        return true;
+    }
+}
+
+#else
+
+template<typename Op>
+bool Dispatch(Op&&) {
+    return false;
+}
+
+#endif  // ADVANCED_VECTOR_SIMD
+
+// Index of the first element equal to `value`, or `size`.
+template<typename T>
+size_t Find(const T* data, const size_t size, const T& value) {
+    if constexpr (HasLaneV<T>) {
+        size_t result = 0;
+        if(Dispatch([&](auto target) { result = target.Find(data, size, value); })) {
+            return result;
+        }
+    }
+    return static_cast<size_t>(std::find(data, data + size, value) - data);
+}
+
+template<typename T>
+size_t Count(const T* data, const size_t size, const T& value) {
+    if constexpr (HasLaneV<T>) {
+        size_t result = 0;
+        if(Dispatch([&](auto target) { result = target.Count(data, size, value); })) {
+            return result;
+        }
+    }
+    return static_cast<size_t>(std::count(data, data + size, value));
+}
+
+// Index of the first position where the ranges differ, or `size`. Only
+// integer lanes are used, since for them equality is bitwise.
+template<typename T>
+size_t Mismatch(const T* lhs, const T* rhs, const size_t size) {
+    if constexpr (HasLaneV<T> && std::is_integral_v<T>) {
+        size_t result = 0;
+        if(Dispatch([&](auto target) { result = target.Mismatch(lhs, rhs, size); })) {
+            return result;
+        }
+    }
+    return static_cast<size_t>(std::mismatch(lhs, lhs + size, rhs).first - lhs);
+}
+
+// The first element no other element compares less than (for Max, greater
+// than); `size` must not be zero.
+template<bool Max, typename T>
+T MinMax(const T* data, const size_t size) {
+    if constexpr (HasLaneV<T>) {
+        T result{};
+        if(Dispatch([&](auto target) { result = target.template MinMax<Max>(data, size); })) {
+            return result;
+        }
+    }
+    return Max ? *std::max_element(data, data + size) : *std::min_element(data, data + size);
+}
+
+// Floating-point sums are taken in a different order than a sequential
+// loop, so the last bits may differ from std::accumulate.
+template<typename T>
+T Sum(const T* data, const size_t size) {
+    if constexpr (HasLaneV<T>) {
+        T result{};
+        if(Dispatch([&](auto target) { result = target.Sum(data, size); })) {
+            return result;
+        }
+    }
+    T result{};
+    for(size_t i = 0; i != size; ++i) {
+        result = result + data[i];
+    }
+    return result;
+}
+
+}  // namespace detail::simd
@@ -0,0 +1,264 @@
+#pragma once
+
+#include "vector.h"
+
+// Vector with inline storage for N elements. It only allocates through
+// RawMemory once it outgrows the inline buffer.
+template<typename T, size_t N, typename Allocator = std::allocator<T>, typename GrowthPolicy = DoublingGrowthPolicy>
+class SmallVector {
+    using AllocTraits = std::allocator_traits<Allocator>;
+
+public:
+    static_assert(N > 0, "SmallVector needs room for at least one inline element");
+
+    using value_type = T;
+    using allocator_type = Allocator;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    SmallVector() = default;
+
+    explicit SmallVector(const Allocator& alloc) noexcept
+    : heap_(alloc) {
+    }
+
+    explicit SmallVector(const size_t count, const Allocator& alloc = Allocator())
+    : heap_(count > N ? count : 0, alloc) {
+        std::uninitialized_value_construct_n(Data(), count);
+        size_ = count;
+    }
+
+    SmallVector(const SmallVector& other)
+    : heap_(other.size_ > N ? other.size_ : 0,
+            AllocTraits::select_on_container_copy_construction(other.heap_.GetAllocator())) {
+        std::uninitialized_copy_n(other.Data(), other.size_, Data());
+        size_ = other.size_;
+    }
+
+    SmallVector(SmallVector&& other) noexcept(std::is_nothrow_move_constructible_v<T>)
+    : heap_(other.heap_.GetAllocator()) {
+        if(other.IsInline()) {
+            detail::RelocateN(other.Data(), other.size_, Data());
+            size_ = std::exchange(other.size_, 0);
+        } else {
+            heap_.Swap(other.heap_);
+            size_ = std::exchange(other.size_, 0);
+        }
+    }
+
+    ~SmallVector() {
+        std::destroy_n(Data(), size_);
+    }
+
+    [[nodiscard]] allocator_type GetAllocator() const noexcept {
+        return heap_.GetAllocator();
+    }
+
+    iterator begin() noexcept {
+        return Data();
+    }
+
+    const_iterator cbegin() const noexcept {
+        return Data();
+    }
+
+    const_iterator begin() const noexcept {
+        return cbegin();
+    }
+
+    iterator end() noexcept {
+        return Data() + size_;
+    }
+
+    const_iterator cend() const noexcept {
+        return Data() + size_;
+    }
+
+    const_iterator end() const noexcept {
+        return cend();
+    }
+
+    [[nodiscard]] size_t Capacity() const noexcept {
+        return IsInline() ? N : heap_.Capacity();
+    }
+
+    [[nodiscard]] size_t Size() const noexcept {
+        return size_;
+    }
+
+    [[nodiscard]] bool IsInline() const noexcept {
+        return heap_.Capacity() == 0;
+    }
+
+    void Reserve(const size_t new_capacity) {
+        if(new_capacity <= Capacity()) {
+            return;
+        }
+
+        if constexpr (IsTriviallyRelocatableV<T>) {
+            if(!IsInline() && heap_.TryExpand(new_capacity)) {
+                return;
+            }
+        }
+
+        RawMemory<T, Allocator> new_data(new_capacity, heap_.GetAllocator());
+
+        detail::RelocateN(Data(), size_, new_data.GetAddress());
+
+        heap_.Swap(new_data);
+    }
+
+    void Resize(const size_t new_size) {
+        if(new_size < size_) {
+            std::destroy_n(Data() + new_size, size_ - new_size);
+        } else if(new_size > size_) {
+            Reserve(new_size);
+            std::uninitialized_value_construct_n(Data() + size_, new_size - size_);
+        }
+        size_ = new_size;
+    }
+
+    template<typename Type>
+    void PushBack(Type&& elem) {
+        Emplace(cend(), std::forward<Type>(elem));
+    }
+
+    void PopBack() noexcept {
+        assert(size_ > 0);
+        std::destroy_at(Data() + (size_ - 1));
+        --size_;
+    }
+
+    template<typename... Args>
+    iterator Emplace(const_iterator pos, Args&&... args) {
+        size_t position = pos - begin();
+        if(size_ == Capacity()) {
+            EmplaceWithAllocate(position, std::forward<Args>(args)...);
+        } else {
+            detail::EmplaceInSpare(Data(), size_, position, std::forward<Args>(args)...);
+        }
+        ++size_;
+        return begin() + position;
+    }
+
+    template<typename... Args>
+    T& EmplaceBack(Args&&... args) {
+        return *Emplace(cend(), std::forward<Args>(args)...);
+    }
+
+    iterator Insert(const_iterator pos, const T& elem) {
+        return Emplace(pos, elem);
+    }
+
+    iterator Insert(const_iterator pos, T&& elem) {
+        return Emplace(pos, std::move(elem));
+    }
+
+    iterator Erase(const_iterator pos) {
+        assert(pos < end() && pos >= begin());
+        size_t position = pos - begin();
+        detail::EraseAt(Data(), size_, position);
+        --size_;
+        return begin() + position;
+    }
+
+    void Swap(SmallVector& other) noexcept(std::is_nothrow_move_constructible_v<T>
+                                           && std::is_nothrow_move_assignable_v<T>) {
+        if(!IsInline() && !other.IsInline()) {
+            heap_.Swap(other.heap_);
+            std::swap(size_, other.size_);
+        } else {
+            SmallVector temp(std::move(other));
+            other = std::move(*this);
+            *this = std::move(temp);
+        }
+    }
+
+    const T& operator[](const size_t index) const noexcept {
+        return const_cast<SmallVector&>(*this)[index];
+    }
+
+    T& operator[](const size_t index) noexcept {
+        assert(index < size_);
+        return Data()[index];
+    }
+
+    SmallVector& operator=(const SmallVector& other) {
+        if(this != &other) {
+            if constexpr (AllocTraits::propagate_on_container_copy_assignment::value) {
+                if(heap_.GetAllocator() != other.heap_.GetAllocator()) {
+                    std::destroy_n(Data(), size_);
+                    size_ = 0;
+                }
+                heap_.CopyAllocator(other.heap_.GetAllocator());
+            }
+            AssignN(other.Data(), other.size_);
+        }
+        return *this;
+    }
+
+    SmallVector& operator=(SmallVector&& other) noexcept(std::is_nothrow_move_constructible_v<T>
+                                                         && std::is_nothrow_move_assignable_v<T>
+                                                         && (AllocTraits::propagate_on_container_move_assignment::value
+                                                             || AllocTraits::is_always_equal::value)) {
+        if(this != &other) {
+            if(!other.IsInline() && (AllocTraits::propagate_on_container_move_assignment::value
+                                     || heap_.GetAllocator() == other.heap_.GetAllocator())) {
+                std::destroy_n(Data(), size_);
+                heap_ = std::move(other.heap_);
+                size_ = std::exchange(other.size_, 0);
+            } else {
+                AssignN(std::make_move_iterator(other.begin()), other.size_);
+                other.Clear();
+            }
+        }
+        return *this;
+    }
+
+private:
+    RawMemory<T, Allocator> heap_;
+    size_t size_ = 0;
+    alignas(T) unsigned char inline_[N * sizeof(T)];
+
+    T* Data() noexcept {
+        return IsInline() ? reinterpret_cast<T*>(inline_) : heap_.GetAddress();
+    }
+
+    const T* Data() const noexcept {
+        return const_cast<SmallVector&>(*this).Data();
+    }
+
+    void Clear() noexcept {
+        std::destroy_n(Data(), size_);
+        size_ = 0;
+    }
+
+    size_t GrowCapacity(const size_t required) const noexcept {
+        return std::max(required, GrowthPolicy::NextCapacity(Capacity(), required, sizeof(T)));
+    }
+
+    template<typename InputIt>
+    void AssignN(InputIt first, const size_t count) {
+        if(Capacity() < count) {
+            RawMemory<T, Allocator> new_data(count, heap_.GetAllocator());
+            std::uninitialized_copy_n(first, count, new_data.GetAddress());
+            std::destroy_n(Data(), size_);
+            heap_.Swap(new_data);
+        } else if(size_ < count) {
+            std::copy_n(first, size_, Data());
+            std::uninitialized_copy_n(std::next(first, size_), count - size_, Data() + size_);
+        } else {
+            std::copy_n(first, count, Data());
+            std::destroy_n(Data() + count, size_ - count);
+        }
+        size_ = count;
+    }
+
+    template<typename... Args>
+    void EmplaceWithAllocate(const size_t position, Args&&... args) {
+        RawMemory<T, Allocator> temp(GrowCapacity(size_ + 1), heap_.GetAllocator());
+        new (temp + position) T(std::forward<Args>(args)...);
+        detail::RelocateAround(Data(), size_, position, temp.GetAddress());
+        heap_.Swap(temp);
+    }
+};
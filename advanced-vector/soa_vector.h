@@ -0,0 +1,468 @@
+#pragma once
+
+#include "vector.h"
+
+#include <tuple>
+
+// Contiguous view of one column of a SoAVector.
+template<typename T>
+class ColumnSpan {
+public:
+    ColumnSpan(T* data, const size_t size) noexcept
+    : data_(data)
+    , size_(size) {
+    }
+
+    T* begin() const noexcept {
+        return data_;
+    }
+
+    T* end() const noexcept {
+        return data_ + size_;
+    }
+
+    [[nodiscard]] T* Data() const noexcept {
+        return data_;
+    }
+
+    [[nodiscard]] size_t Size() const noexcept {
+        return size_;
+    }
+
+    T& operator[](const size_t index) const noexcept {
+        assert(index < size_);
+        return data_[index];
+    }
+
+#ifdef __cpp_lib_span
+    operator std::span<T>() const noexcept {
+        return {data_, size_};
+    }
+#endif
+
+private:
+    T* data_;
+    size_t size_;
+};
+
+// Struct-of-arrays container: every field lives in its own RawMemory column,
+// and all columns share one size and one capacity, so a loop over a single
+// field streams through memory that holds nothing else. Rows are accessed
+// through tuples of references.
+template<typename GrowthPolicy, typename... Fields>
+class BasicSoAVector {
+    static_assert(sizeof...(Fields) > 0, "SoAVector needs at least one field");
+
+    using Columns = std::tuple<RawMemory<Fields>...>;
+
+    static constexpr size_t FIELD_COUNT = sizeof...(Fields);
+    static constexpr size_t ROW_SIZE = (sizeof(Fields) + ...);
+    static constexpr bool RELOCATABLE = (IsTriviallyRelocatableV<Fields> && ...);
+    // Rows are moved only if no field can throw on move; otherwise a failure
+    // in a later column would leave the earlier ones moved-from.
+    static constexpr bool NOTHROW_MOVE = (std::is_nothrow_move_constructible_v<Fields> && ...);
+    // Erasing shifts each column separately, which must not fail halfway.
+    static constexpr bool NOTHROW_SHIFT =
+        ((IsTriviallyRelocatableV<Fields> || std::is_nothrow_move_assignable_v<Fields>) && ...);
+
+    template<bool IsConst>
+    class Iterator;
+
+public:
+    template<size_t I>
+    using FieldType = std::tuple_element_t<I, std::tuple<Fields...>>;
+
+    using reference = std::tuple<Fields&...>;
+    using const_reference = std::tuple<const Fields&...>;
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    BasicSoAVector() = default;
+
+    explicit BasicSoAVector(const size_t size)
+    : columns_(RawMemory<Fields>(size)...) {
+        ValueConstructColumns(0, size);
+        size_ = size;
+    }
+
+    BasicSoAVector(const BasicSoAVector& other)
+    : columns_(RawMemory<Fields>(other.size_)...) {
+        CopyColumnsFrom(other);
+        size_ = other.size_;
+    }
+
+    BasicSoAVector(BasicSoAVector&& other) noexcept
+    : columns_(std::move(other.columns_))
+    , size_(std::exchange(other.size_, 0)) {
+    }
+
+    ~BasicSoAVector() {
+        DestroyRows(0, size_);
+    }
+
+    BasicSoAVector& operator=(const BasicSoAVector& other) {
+        if(this != &other) {
+            BasicSoAVector copy(other);
+            Swap(copy);
+        }
+        return *this;
+    }
+
+    BasicSoAVector& operator=(BasicSoAVector&& other) noexcept {
+        if(this != &other) {
+            DestroyRows(0, size_);
+            columns_ = std::move(other.columns_);
+            size_ = std::exchange(other.size_, 0);
+        }
+        return *this;
+    }
+
+    void Swap(BasicSoAVector& other) noexcept {
+        ForEachColumnPair(other.columns_, [](auto& column, auto& other_column) {
+            column.Swap(other_column);
+        });
+        std::swap(size_, other.size_);
+    }
+
+    iterator begin() noexcept {
+        return iterator(this, 0);
+    }
+
+    const_iterator cbegin() const noexcept {
+        return const_iterator(this, 0);
+    }
+
+    const_iterator begin() const noexcept {
+        return cbegin();
+    }
+
+    iterator end() noexcept {
+        return iterator(this, size_);
+    }
+
+    const_iterator cend() const noexcept {
+        return const_iterator(this, size_);
+    }
+
+    const_iterator end() const noexcept {
+        return cend();
+    }
+
+    [[nodiscard]] size_t Size() const noexcept {
+        return size_;
+    }
+
+    [[nodiscard]] size_t Capacity() const noexcept {
+        return std::get<0>(columns_).Capacity();
+    }
+
+    template<size_t I>
+    ColumnSpan<FieldType<I>> Column() noexcept {
+        return {std::get<I>(columns_).GetAddress(), size_};
+    }
+
+    template<size_t I>
+    ColumnSpan<const FieldType<I>> Column() const noexcept {
+        return {std::get<I>(columns_).GetAddress(), size_};
+    }
+
+    template<size_t I>
+    FieldType<I>& Get(const size_t index) noexcept {
+        assert(index < size_);
+        return std::get<I>(columns_)[index];
+    }
+
+    template<size_t I>
+    const FieldType<I>& Get(const size_t index) const noexcept {
+        assert(index < size_);
+        return std::get<I>(columns_)[index];
+    }
+
+    reference operator[](const size_t index) noexcept {
+        assert(index < size_);
+        return std::apply([index](auto&... column) {
+            return reference(column[index]...);
+        }, columns_);
+    }
+
+    const_reference operator[](const size_t index) const noexcept {
+        assert(index < size_);
+        return std::apply([index](const auto&... column) {
+            return const_reference(column[index]...);
+        }, columns_);
+    }
+
+    void Reserve(const size_t new_capacity) {
+        if(new_capacity > Capacity()) {
+            Columns new_columns{RawMemory<Fields>(new_capacity)...};
+            RelocateRowsTo(new_columns);
+            columns_ = std::move(new_columns);
+        }
+    }
+
+    void ShrinkToFit() {
+        if(size_ < Capacity()) {
+            Columns new_columns{RawMemory<Fields>(size_)...};
+            RelocateRowsTo(new_columns);
+            columns_ = std::move(new_columns);
+        }
+    }
+
+    void Resize(const size_t new_size) {
+        if(new_size > size_) {
+            Reserve(new_size);
+            ValueConstructColumns(size_, new_size - size_);
+        } else {
+            DestroyRows(new_size, size_ - new_size);
+        }
+        size_ = new_size;
+    }
+
+    // Takes one constructor argument per field. If a field throws, the fields
+    // already built for the row are destroyed and the container is unchanged.
+    template<typename... Args>
+    reference EmplaceBack(Args&&... args) {
+        static_assert(sizeof...(Args) == FIELD_COUNT, "EmplaceBack takes one argument per field");
+        if(size_ == Capacity()) {
+            // The row is built in the new columns first, since `args` may
+            // refer to the elements that are about to be relocated.
+            Columns new_columns{RawMemory<Fields>(GrowCapacity(size_ + 1))...};
+            ConstructRow<0>(new_columns, size_, std::forward<Args>(args)...);
+            ADVANCED_VECTOR_TRY {
+                RelocateRowsTo(new_columns);
+            } ADVANCED_VECTOR_CATCH_ALL {
+                DestroyRows(new_columns, size_, 1);
+                ADVANCED_VECTOR_RETHROW;
+            }
+            columns_ = std::move(new_columns);
+        } else {
+            ConstructRow<0>(columns_, size_, std::forward<Args>(args)...);
+        }
+        ++size_;
+        return (*this)[size_ - 1];
+    }
+
+    template<typename... Args>
+    void PushBack(Args&&... args) {
+        EmplaceBack(std::forward<Args>(args)...);
+    }
+
+    void PopBack() noexcept {
+        assert(size_ > 0);
+        DestroyRows(size_ - 1, 1);
+        --size_;
+    }
+
+    iterator Erase(const const_iterator pos) noexcept {
+        static_assert(NOTHROW_SHIFT, "Erase needs fields that shift without throwing");
+        const size_t position = pos.Index();
+        assert(position < size_);
+        ForEachColumn([this, position](auto& column) {
+            detail::EraseAt(column.GetAddress(), size_, position);
+        });
+        --size_;
+        return begin() + position;
+    }
+
+    // Moves the last row into the erased one instead of shifting the tail.
+    iterator EraseUnordered(const const_iterator pos) noexcept {
+        static_assert(NOTHROW_SHIFT, "EraseUnordered needs fields that shift without throwing");
+        const size_t position = pos.Index();
+        assert(position < size_);
+        ForEachColumn([this, position](auto& column) {
+            detail::EraseUnorderedAt(column.GetAddress(), size_, position);
+        });
+        --size_;
+        return begin() + position;
+    }
+
+private:
+    Columns columns_;
+    size_t size_ = 0;
+
+    template<typename Op>
+    void ForEachColumn(Op op) {
+        std::apply([&op](auto&... column) {
+            (op(column), ...);
+        }, columns_);
+    }
+
+    template<typename Op, size_t... Is>
+    void ForEachColumnPair(Columns& other, Op& op, std::index_sequence<Is...>) {
+        (op(std::get<Is>(columns_), std::get<Is>(other)), ...);
+    }
+
+    template<typename Op>
+    void ForEachColumnPair(Columns& other, Op op) {
+        ForEachColumnPair(other, op, std::index_sequence_for<Fields...>{});
+    }
+
+    size_t GrowCapacity(const size_t required) const noexcept {
+        return std::max(required, GrowthPolicy::NextCapacity(Capacity(), required, ROW_SIZE));
+    }
+
+    static void DestroyRows(Columns& columns, const size_t first, const size_t count) noexcept {
+        std::apply([first, count](auto&... column) {
+            (std::destroy_n(column.GetAddress() + first, count), ...);
+        }, columns);
+    }
+
+    void DestroyRows(const size_t first, const size_t count) noexcept {
+        DestroyRows(columns_, first, count);
+    }
+
+    template<size_t I, typename Arg, typename... Rest>
+    static void ConstructRow(Columns& columns, const size_t index, Arg&& arg, Rest&&... rest) {
+        FieldType<I>* field = new (std::get<I>(columns) + index) FieldType<I>(std::forward<Arg>(arg));
+        if constexpr (sizeof...(Rest) != 0) {
+            ADVANCED_VECTOR_TRY {
+                ConstructRow<I + 1>(columns, index, std::forward<Rest>(rest)...);
+            } ADVANCED_VECTOR_CATCH_ALL {
+                std::destroy_at(field);
+                ADVANCED_VECTOR_RETHROW;
+            }
+        }
+    }
+
+    template<size_t I = 0>
+    void ValueConstructColumns(const size_t first, const size_t count) {
+        FieldType<I>* column = std::get<I>(columns_) + first;
+        std::uninitialized_value_construct_n(column, count);
+        if constexpr (I + 1 != FIELD_COUNT) {
+            ADVANCED_VECTOR_TRY {
+                ValueConstructColumns<I + 1>(first, count);
+            } ADVANCED_VECTOR_CATCH_ALL {
+                std::destroy_n(column, count);
+                ADVANCED_VECTOR_RETHROW;
+            }
+        }
+    }
+
+    template<size_t I = 0>
+    void CopyColumnsFrom(const BasicSoAVector& other) {
+        FieldType<I>* column = std::get<I>(columns_).GetAddress();
+        std::uninitialized_copy_n(std::get<I>(other.columns_).GetAddress(), other.size_, column);
+        if constexpr (I + 1 != FIELD_COUNT) {
+            ADVANCED_VECTOR_TRY {
+                CopyColumnsFrom<I + 1>(other);
+            } ADVANCED_VECTOR_CATCH_ALL {
+                std::destroy_n(column, other.size_);
+                ADVANCED_VECTOR_RETHROW;
+            }
+        }
+    }
+
+    template<size_t I = 0>
+    void CopyOrMoveColumnsTo(Columns& to) {
+        FieldType<I>* column = std::get<I>(to).GetAddress();
+        FieldType<I>* from = std::get<I>(columns_).GetAddress();
+        if constexpr (NOTHROW_MOVE || !std::is_copy_constructible_v<FieldType<I>>) {
+            detail::UninitializedCopyN(std::make_move_iterator(from), size_, column);
+        } else {
+            detail::UninitializedCopyN(from, size_, column);
+        }
+        if constexpr (I + 1 != FIELD_COUNT) {
+            ADVANCED_VECTOR_TRY {
+                CopyOrMoveColumnsTo<I + 1>(to);
+            } ADVANCED_VECTOR_CATCH_ALL {
+                std::destroy_n(column, size_);
+                ADVANCED_VECTOR_RETHROW;
+            }
+        }
+    }
+
+    // Moves the rows into `to`, or copies all of them when any field may
+    // throw on move; on failure the current columns are untouched.
+    void RelocateRowsTo(Columns& to) {
+        if constexpr (RELOCATABLE) {
+            ForEachColumnPair(to, [this](auto& column, auto& new_column) {
+                detail::RelocateN(column.GetAddress(), size_, new_column.GetAddress());
+            });
+        } else {
+            CopyOrMoveColumnsTo(to);
+            DestroyRows(0, size_);
+        }
+    }
+
+    template<bool IsConst>
+    class Iterator {
+        using Owner = std::conditional_t<IsConst, const BasicSoAVector, BasicSoAVector>;
+
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = std::tuple<Fields...>;
+        using difference_type = std::ptrdiff_t;
+        using reference = std::conditional_t<IsConst, const_reference, BasicSoAVector::reference>;
+        using pointer = void;
+
+        Iterator() = default;
+
+        template<bool OtherConst, typename = std::enable_if_t<IsConst && !OtherConst>>
+        Iterator(const Iterator<OtherConst>& other) noexcept
+        : owner_(other.owner_)
+        , index_(other.index_) {
+        }
+
+        reference operator*() const noexcept {
+            return (*owner_)[index_];
+        }
+
+        [[nodiscard]] size_t Index() const noexcept {
+            return index_;
+        }
+
+        Iterator& operator++() noexcept {
+            ++index_;
+            return *this;
+        }
+
+        Iterator operator++(int) noexcept {
+            Iterator old = *this;
+            ++index_;
+            return old;
+        }
+
+        Iterator& operator--() noexcept {
+            --index_;
+            return *this;
+        }
+
+        Iterator& operator+=(const difference_type offset) noexcept {
+            index_ += offset;
+            return *this;
+        }
+
+        Iterator operator+(const difference_type offset) const noexcept {
+            return Iterator(owner_, index_ + offset);
+        }
+
+        difference_type operator-(const Iterator& other) const noexcept {
+            return static_cast<difference_type>(index_) - static_cast<difference_type>(other.index_);
+        }
+
+        bool operator==(const Iterator& other) const noexcept {
+            return index_ == other.index_ && owner_ == other.owner_;
+        }
+
+        bool operator!=(const Iterator& other) const noexcept {
+            return !(*this == other);
+        }
+
+    private:
+        friend class BasicSoAVector;
+
+        template<bool>
+        friend class Iterator;
+
+        Iterator(Owner* owner, const size_t index) noexcept
+        : owner_(owner)
+        , index_(index) {
+        }
+
+        Owner* owner_ = nullptr;
+        size_t index_ = 0;
+    };
+};
+
+template<typename... Fields>
+using SoAVector = BasicSoAVector<DoublingGrowthPolicy, Fields...>;
@@ -1,327 +1,2035 @@
 #pragma once
 
 #include <new>
+#include <algorithm>
 #include <memory>
 #include <cassert>
 #include <utility>
 #include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <array>
+#include <stdexcept>
+#include <initializer_list>
+
+#if __cplusplus >= 202002L && __has_include(<span>)
+#include <span>
+#endif
+
+#include "simd.h"
+
+// Builds without exceptions (-fno-exceptions, or ADVANCED_VECTOR_NO_EXCEPTIONS
+// defined by hand) get no try/catch blocks at all: errors that would throw
+// abort instead, and the Try* members of Vector report allocation failure
+// through VectorStatus.
+#if !defined(ADVANCED_VECTOR_NO_EXCEPTIONS) && !defined(__cpp_exceptions)
+#define ADVANCED_VECTOR_NO_EXCEPTIONS
+#endif
+
+#ifdef ADVANCED_VECTOR_NO_EXCEPTIONS
+#define ADVANCED_VECTOR_TRY if(true)
+#define ADVANCED_VECTOR_CATCH_ALL if(false)
+#define ADVANCED_VECTOR_RETHROW ((void)0)
+#define ADVANCED_VECTOR_THROW(exception) std::abort()
+#else
+#define ADVANCED_VECTOR_TRY try
+#define ADVANCED_VECTOR_CATCH_ALL catch(...)
+#define ADVANCED_VECTOR_RETHROW throw
+#define ADVANCED_VECTOR_THROW(exception) throw exception
+#endif
+
+#if defined(__has_cpp_attribute) && __has_cpp_attribute(no_unique_address)
+#define ADVANCED_VECTOR_NO_UNIQUE_ADDRESS [[no_unique_address]]
+#else
+#define ADVANCED_VECTOR_NO_UNIQUE_ADDRESS
+#endif
+
+// With C++20 constexpr allocation Vector and RawMemory also work during
+// constant evaluation, e.g. to build lookup tables copied out with ToArray.
+#if defined(__cpp_lib_constexpr_dynamic_alloc) && defined(__cpp_lib_is_constant_evaluated)
+#define ADVANCED_VECTOR_HAS_CONSTEXPR
+#define ADVANCED_VECTOR_CONSTEXPR constexpr
+#else
+#define ADVANCED_VECTOR_CONSTEXPR
+#endif
+
+#include "hardening.h"
+
+// Types for which moving to a new address and destroying the source is
+// equivalent to copying the bytes. Specialize it for your own types to let
+// Vector relocate them with memcpy/memmove.
+template<typename T>
+struct IsTriviallyRelocatable : std::is_trivially_copyable<T> {
+};
+
+template<typename T>
+inline constexpr bool IsTriviallyRelocatableV = IsTriviallyRelocatable<T>::value;
+
+enum class [[nodiscard]] VectorStatus {
+    OK,
+    ALLOCATION_FAILED,
+    // A fixed-capacity container is full.
+    CAPACITY_EXCEEDED,
+};
+
+// Allocator on top of malloc/free that can also grow a block with realloc.
+// glibc serves large blocks with mmap and realloc grows them with mremap, so
+// big buffers are extended without copying their contents.
+template<typename T>
+struct MallocAllocator {
+    using value_type = T;
+    using is_always_equal = std::true_type;
+
+    MallocAllocator() = default;
+
+    template<typename U>
+    MallocAllocator(const MallocAllocator<U>&) noexcept {
+    }
+
+    T* allocate(const size_t count) {
+        if(count > SIZE_MAX / sizeof(T)) {
+            ADVANCED_VECTOR_THROW(std::bad_array_new_length());
+        }
+        void* ptr = std::malloc(count * sizeof(T));
+        if(ptr == nullptr) {
+            ADVANCED_VECTOR_THROW(std::bad_alloc());
+        }
+        return static_cast<T*>(ptr);
+    }
+
+    // Returns nullptr instead of throwing.
+    T* try_allocate(const size_t count) noexcept {
+        return count <= SIZE_MAX / sizeof(T) ? static_cast<T*>(std::malloc(count * sizeof(T))) : nullptr;
+    }
+
+    void deallocate(T* ptr, size_t /*count*/) noexcept {
+        std::free(ptr);
+    }
+
+    // Returns nullptr and leaves ptr intact on failure.
+    T* reallocate(T* ptr, size_t /*old_count*/, const size_t new_count) noexcept {
+        if(new_count > SIZE_MAX / sizeof(T)) {
+            return nullptr;
+        }
+        return static_cast<T*>(std::realloc(ptr, new_count * sizeof(T)));
+    }
+
+    template<typename U>
+    bool operator==(const MallocAllocator<U>&) const noexcept {
+        return true;
+    }
+
+    template<typename U>
+    bool operator!=(const MallocAllocator<U>&) const noexcept {
+        return false;
+    }
+};
+
+inline constexpr size_t CACHE_LINE_SIZE = 64;
+
+// Allocator returning Alignment-aligned blocks, e.g. for SIMD loads or to keep
+// a buffer on its own cache lines. With PadToAlignment the block size is also
+// rounded up to a multiple of Alignment, so the last line of one buffer is
+// never shared with the start of a neighbouring allocation.
+template<typename T, size_t Alignment = CACHE_LINE_SIZE, bool PadToAlignment = false>
+struct AlignedAllocator {
+    static_assert(Alignment != 0 && (Alignment & (Alignment - 1)) == 0, "Alignment must be a power of two");
+    static_assert(Alignment >= alignof(T), "Alignment must not weaken the alignment of T");
+
+    using value_type = T;
+    using is_always_equal = std::true_type;
+
+    template<typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment, PadToAlignment>;
+    };
+
+    AlignedAllocator() = default;
+
+    template<typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment, PadToAlignment>&) noexcept {
+    }
+
+    T* allocate(const size_t count) {
+        if(count > (SIZE_MAX - Alignment) / sizeof(T)) {
+            ADVANCED_VECTOR_THROW(std::bad_array_new_length());
+        }
+        return static_cast<T*>(operator new(BlockSize(count), std::align_val_t{Alignment}));
+    }
+
+    T* try_allocate(const size_t count) noexcept {
+        if(count > (SIZE_MAX - Alignment) / sizeof(T)) {
+            return nullptr;
+        }
+        return static_cast<T*>(operator new(BlockSize(count), std::align_val_t{Alignment}, std::nothrow));
+    }
+
+    void deallocate(T* ptr, const size_t count) noexcept {
+        operator delete(ptr, BlockSize(count), std::align_val_t{Alignment});
+    }
+
+    template<typename U>
+    bool operator==(const AlignedAllocator<U, Alignment, PadToAlignment>&) const noexcept {
+        return true;
+    }
+
+    template<typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment, PadToAlignment>&) const noexcept {
+        return false;
+    }
+
+private:
+    static constexpr size_t BlockSize(const size_t count) noexcept {
+        const size_t bytes = count * sizeof(T);
+        return PadToAlignment ? (bytes + Alignment - 1) / Alignment * Alignment : bytes;
+    }
+};
+
+namespace detail {
+
+template<typename Allocator, typename = void>
+struct HasReallocate : std::false_type {
+};
+
+template<typename Allocator>
+struct HasReallocate<Allocator, std::void_t<decltype(std::declval<Allocator&>().reallocate(
+    std::declval<typename std::allocator_traits<Allocator>::pointer>(), size_t{}, size_t{}))>> : std::true_type {
+};
+
+template<typename Allocator, typename = void>
+struct HasTryAllocate : std::false_type {
+};
+
+template<typename Allocator>
+struct HasTryAllocate<Allocator, std::void_t<decltype(std::declval<Allocator&>().try_allocate(size_t{}))>>
+    : std::true_type {
+};
+
+// Allocates through Allocator::try_allocate when there is one and through
+// nothrow operator new for std::allocator. Other allocators are called as
+// usual; without exceptions their failure cannot be observed here.
+template<typename Allocator>
+typename std::allocator_traits<Allocator>::value_type* TryAllocate(Allocator& alloc, const size_t count) noexcept {
+    using T = typename std::allocator_traits<Allocator>::value_type;
+    if constexpr (HasTryAllocate<Allocator>::value) {
+        return alloc.try_allocate(count);
+    } else if constexpr (std::is_same_v<Allocator, std::allocator<T>>) {
+        if(count > SIZE_MAX / sizeof(T)) {
+            return nullptr;
+        }
+        if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            return static_cast<T*>(operator new(count * sizeof(T), std::align_val_t{alignof(T)}, std::nothrow));
+        } else {
+            return static_cast<T*>(operator new(count * sizeof(T), std::nothrow));
+        }
+    } else {
+#ifdef ADVANCED_VECTOR_NO_EXCEPTIONS
+        return std::allocator_traits<Allocator>::allocate(alloc, count);
+#else
+        try {
+            return std::allocator_traits<Allocator>::allocate(alloc, count);
+        } catch (...) {
+            return nullptr;
+        }
+#endif
+    }
+}
+
+[[nodiscard]] constexpr bool IsConstantEvaluated() noexcept {
+#ifdef ADVANCED_VECTOR_HAS_CONSTEXPR
+    return std::is_constant_evaluated();
+#else
+    return false;
+#endif
+}
+
+template<typename T, typename... Args>
+ADVANCED_VECTOR_CONSTEXPR T* ConstructAt(T* place, Args&&... args) {
+#ifdef ADVANCED_VECTOR_HAS_CONSTEXPR
+    return std::construct_at(place, std::forward<Args>(args)...);
+#else
+    return ::new (static_cast<void*>(place)) T(std::forward<Args>(args)...);
+#endif
+}
+
+// The std::uninitialized_* algorithms are not constexpr in C++20; during
+// constant evaluation these construct element by element instead. Default
+// initialization becomes value initialization there, since indeterminate
+// values cannot be read at compile time.
+template<typename InputIt, typename T>
+ADVANCED_VECTOR_CONSTEXPR void UninitializedCopyN(InputIt first, const size_t count, T* to) {
+    if(IsConstantEvaluated()) {
+        for(size_t i = 0; i != count; ++i, ++first) {
+            ConstructAt(to + i, *first);
+        }
+    } else {
+        std::uninitialized_copy_n(first, count, to);
+    }
+}
 
 template<typename T>
+ADVANCED_VECTOR_CONSTEXPR void UninitializedValueConstructN(T* to, const size_t count) {
+    if(IsConstantEvaluated()) {
+        for(size_t i = 0; i != count; ++i) {
+            ConstructAt(to + i);
+        }
+    } else {
+        std::uninitialized_value_construct_n(to, count);
+    }
+}
+
+template<typename T>
+ADVANCED_VECTOR_CONSTEXPR void UninitializedDefaultConstructN(T* to, const size_t count) {
+    if(IsConstantEvaluated()) {
+        UninitializedValueConstructN(to, count);
+    } else {
+        std::uninitialized_default_construct_n(to, count);
+    }
+}
+
+// Index of the highest set bit; `value` must be nonzero.
+constexpr size_t FloorLog2(size_t value) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+    return sizeof(unsigned long long) * CHAR_BIT - 1 - static_cast<size_t>(__builtin_clzll(value));
+#else
+    size_t result = 0;
+    while(value >>= 1) {
+        ++result;
+    }
+    return result;
+#endif
+}
+
+}  // namespace detail
+
+template<typename T, typename Allocator = std::allocator<T>>
 class RawMemory {
+    using AllocTraits = std::allocator_traits<Allocator>;
+
+public:
+    using allocator_type = Allocator;
+
+    static_assert(std::is_same_v<typename AllocTraits::value_type, T>, "Allocator::value_type must be T");
+
+    RawMemory() = default;
+
+    ADVANCED_VECTOR_CONSTEXPR explicit RawMemory(const Allocator& alloc) noexcept
+    : alloc_(alloc) {
+    }
+
+    ADVANCED_VECTOR_CONSTEXPR explicit RawMemory(const size_t count, const Allocator& alloc = Allocator())
+    : alloc_(alloc)
+    , buffer_(Allocate(count)) 
+    , capacity_(count) {
+    }
+
+    // Takes ownership of `buffer`, which `alloc` allocated for `count` elements.
+    ADVANCED_VECTOR_CONSTEXPR RawMemory(T* buffer, const size_t count, const Allocator& alloc) noexcept
+    : alloc_(alloc)
+    , buffer_(buffer)
+    , capacity_(count) {
+    }
+
+    RawMemory(const RawMemory&) = delete;
+
+    ADVANCED_VECTOR_CONSTEXPR RawMemory(RawMemory&& other) noexcept 
+    : alloc_(std::move(other.alloc_))
+    , buffer_(std::exchange(other.buffer_, nullptr)) 
+    , capacity_(std::exchange(other.capacity_, 0)) {
+    }
+
+    ADVANCED_VECTOR_CONSTEXPR ~RawMemory() {
+        Deallocate(buffer_, capacity_);
+    }
+
+    [[nodiscard]] ADVANCED_VECTOR_CONSTEXPR size_t Capacity() const noexcept {
+        return capacity_;
+    }
+
+    [[nodiscard]] ADVANCED_VECTOR_CONSTEXPR const Allocator& GetAllocator() const noexcept {
+        return alloc_;
+    }
+
+    ADVANCED_VECTOR_CONSTEXPR const T* GetAddress() const noexcept {
+        return buffer_;
+    }
+    
+    ADVANCED_VECTOR_CONSTEXPR T* GetAddress() noexcept {
+        return buffer_;
+    }
+
+    ADVANCED_VECTOR_CONSTEXPR const T& operator[](const size_t index) const noexcept {
+        return const_cast<RawMemory&>(*this)[index];
+    }
+
+    ADVANCED_VECTOR_CONSTEXPR T& operator[](const size_t index) noexcept {
+        assert(index < capacity_);
+        return buffer_[index];
+    }
+
+    ADVANCED_VECTOR_CONSTEXPR const T* operator+(const size_t offset) const noexcept {
+        return const_cast<RawMemory&>(*this) + offset; 
+    }
+
+    ADVANCED_VECTOR_CONSTEXPR T* operator+(const size_t offset) noexcept {
+        assert(offset <= capacity_);
+        return buffer_ + offset;
+    }
+
+    RawMemory& operator=(const RawMemory&) = delete;
+
+    ADVANCED_VECTOR_CONSTEXPR RawMemory& operator=(RawMemory&& other) noexcept {
+        if(this != &other) {
+            Deallocate(buffer_, capacity_);
+            if constexpr (AllocTraits::propagate_on_container_move_assignment::value) {
+                alloc_ = std::move(other.alloc_);
+            } else {
+                assert(alloc_ == other.alloc_);
+            }
+            buffer_ = std::exchange(other.buffer_, nullptr);
+            capacity_ = std::exchange(other.capacity_, 0);
+        }
+        return *this;
+    }
+ 
+    ADVANCED_VECTOR_CONSTEXPR void Swap(RawMemory& other) noexcept {
+        if constexpr (AllocTraits::propagate_on_container_swap::value) {
+            using std::swap;
+            swap(alloc_, other.alloc_);
+        } else {
+            assert(alloc_ == other.alloc_);
+        }
+        std::swap(buffer_, other.buffer_);
+        std::swap(capacity_, other.capacity_);
+    }
+
+    [[nodiscard]] static constexpr bool CanExpand() noexcept {
+        return detail::HasReallocate<Allocator>::value;
+    }
+
+    // Grows the buffer through Allocator::reallocate, which may move its bytes,
+    // so it is only meant for trivially relocatable T. Returns false and keeps
+    // the buffer when the allocator cannot or did not grow it.
+    ADVANCED_VECTOR_CONSTEXPR bool TryExpand(const size_t new_count) noexcept {
+        static_assert(IsTriviallyRelocatableV<T>, "TryExpand relocates the buffer bytewise");
+        if constexpr (CanExpand()) {
+            if(buffer_ == nullptr || new_count <= capacity_) {
+                return false;
+            }
+            T* new_buffer = alloc_.reallocate(buffer_, capacity_, new_count);
+            if(new_buffer == nullptr) {
+                return false;
+            }
+            buffer_ = new_buffer;
+            capacity_ = new_count;
+            return true;
+        } else {
+            return false;
+        }
+    }
+
+    // Allocates room for `count` elements in an empty RawMemory; returns false
+    // and stays empty when the allocator fails.
+    bool TryAllocate(const size_t count) noexcept {
+        assert(buffer_ == nullptr);
+        if(count == 0) {
+            return true;
+        }
+        buffer_ = detail::TryAllocate(alloc_, count);
+        if(buffer_ == nullptr) {
+            return false;
+        }
+        capacity_ = count;
+        return true;
+    }
+
+    // Gives up the buffer without freeing it; the caller deallocates it with
+    // GetAllocator().
+    T* Release() noexcept {
+        capacity_ = 0;
+        return std::exchange(buffer_, nullptr);
+    }
+
+    // Used by copy assignment when the allocator propagates: memory owned by
+    // an unequal allocator is released before the new one is adopted.
+    void CopyAllocator(const Allocator& alloc) {
+        if(alloc_ != alloc) {
+            Deallocate(buffer_, capacity_);
+            buffer_ = nullptr;
+            capacity_ = 0;
+        }
+        alloc_ = alloc;
+    }
+
+private:
+    ADVANCED_VECTOR_NO_UNIQUE_ADDRESS Allocator alloc_;
+    T* buffer_ = nullptr;
+    size_t capacity_ = 0;
+
+    ADVANCED_VECTOR_CONSTEXPR T* Allocate(const size_t count) {
+        return count != 0 ? AllocTraits::allocate(alloc_, count) : nullptr; 
+    }
+
+    ADVANCED_VECTOR_CONSTEXPR void Deallocate(T* buff, const size_t count) noexcept {
+        if(buff != nullptr) {
+            AllocTraits::deallocate(alloc_, buff, count);
+        }
+    } 
+};
+
+// Destroys and frees a buffer taken out of a Vector with Release(), through
+// the allocator that owned it.
+template<typename T, typename Allocator = std::allocator<T>>
+class BufferDeleter {
+    using AllocTraits = std::allocator_traits<Allocator>;
+
+public:
+    BufferDeleter() = default;
+
+    BufferDeleter(const Allocator& alloc, const size_t size, const size_t capacity) noexcept
+    : alloc_(alloc)
+    , size_(size)
+    , capacity_(capacity) {
+    }
+
+    void operator()(T* buffer) noexcept {
+        std::destroy_n(buffer, size_);
+        AllocTraits::deallocate(alloc_, buffer, capacity_);
+    }
+
+    [[nodiscard]] size_t Size() const noexcept {
+        return size_;
+    }
+
+    [[nodiscard]] size_t Capacity() const noexcept {
+        return capacity_;
+    }
+
+    [[nodiscard]] const Allocator& GetAllocator() const noexcept {
+        return alloc_;
+    }
+
+private:
+    ADVANCED_VECTOR_NO_UNIQUE_ADDRESS Allocator alloc_;
+    size_t size_ = 0;
+    size_t capacity_ = 0;
+};
+
+template<typename T, typename Allocator = std::allocator<T>>
+using BufferPtr = std::unique_ptr<T, BufferDeleter<T, Allocator>>;
+
+// Growth policies decide the capacity of the buffer a full Vector moves to.
+// NextCapacity receives the current capacity, the minimum capacity the
+// operation needs and sizeof(T); Vector never uses less than `required`.
+struct DoublingGrowthPolicy {
+    static constexpr size_t NextCapacity(const size_t capacity, const size_t required, size_t /*elem_size*/) noexcept {
+        return capacity == 0 ? required : std::max(capacity * 2, required);
+    }
+};
+
+// Grows by FactorNum / FactorDen, starts at MinCapacity elements, optionally
+// rounds the buffer up to a malloc-like size class and switches to adding
+// LinearGrowthBytes at a time once the buffer reaches that size (0 disables
+// linear growth).
+template<size_t FactorNum = 3, size_t FactorDen = 2, size_t MinCapacity = 8,
+         size_t LinearGrowthBytes = 0, bool RoundToSizeClass = true>
+struct GeometricGrowthPolicy {
+    static_assert(FactorDen != 0 && FactorNum > FactorDen, "growth factor must be greater than 1");
+
+    static constexpr size_t NextCapacity(const size_t capacity, const size_t required, const size_t elem_size) noexcept {
+        size_t next = 0;
+        if(capacity != 0) {
+            if(LinearGrowthBytes != 0 && capacity >= LinearGrowthBytes / elem_size) {
+                next = capacity + std::max<size_t>(LinearGrowthBytes / elem_size, 1);
+            } else {
+                next = capacity / FactorDen * FactorNum + capacity % FactorDen * FactorNum / FactorDen;
+                next = std::max(next, capacity + 1);
+            }
+        }
+        next = std::max({next, required, MinCapacity});
+        if constexpr (RoundToSizeClass) {
+            next = RoundUpToSizeClass(next * elem_size) / elem_size;
+        }
+        return next;
+    }
+
+private:
+    // 16-byte steps up to 128 bytes, then four classes per power of two up to
+    // a page, then whole pages.
+    static constexpr size_t RoundUpToSizeClass(const size_t bytes) noexcept {
+        constexpr size_t PAGE_SIZE = 4096;
+        if(bytes <= 128) {
+            return (bytes + 15) / 16 * 16;
+        }
+        if(bytes >= PAGE_SIZE) {
+            return (bytes + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+        }
+        size_t power = 128;
+        while(power * 2 < bytes) {
+            power *= 2;
+        }
+        const size_t step = power / 4;
+        return (bytes + step - 1) / step * step;
+    }
+};
+
+// Adds automatic capacity release to a growth policy: once the size drops
+// below capacity / ShrinkDivisor the buffer shrinks to twice the size (but
+// not below MinCapacity). Shrinking to 2x leaves the same headroom in both
+// directions, so a workload oscillating around one size does not reallocate
+// on every push and pop.
+template<typename BasePolicy = DoublingGrowthPolicy, size_t ShrinkDivisor = 4, size_t MinCapacity = 16>
+struct ShrinkingGrowthPolicy : BasePolicy {
+    static_assert(ShrinkDivisor > 2, "shrinking at or above capacity / 2 would thrash");
+
+    static constexpr size_t ShrinkCapacity(const size_t size, const size_t capacity, size_t /*elem_size*/) noexcept {
+        if(capacity <= MinCapacity || size >= capacity / ShrinkDivisor) {
+            return capacity;
+        }
+        return std::max(size * 2, MinCapacity);
+    }
+};
+
+namespace detail {
+
+template<typename Policy, typename = void>
+struct HasShrinkCapacity : std::false_type {
+};
+
+template<typename Policy>
+struct HasShrinkCapacity<Policy, std::void_t<decltype(Policy::ShrinkCapacity(size_t{}, size_t{}, size_t{}))>>
+    : std::true_type {
+};
+
+template<typename T>
+ADVANCED_VECTOR_CONSTEXPR void CopyOrMoveN(T* from, const size_t count, T* to) {
+    if constexpr (std::is_nothrow_move_constructible_v<T> || !std::is_copy_constructible_v<T>) {
+        UninitializedCopyN(std::make_move_iterator(from), count, to);
+    } else {
+        UninitializedCopyN(from, count, to);
+    }
+}
+
+template<typename T>
+void MemMoveN(T* to, const T* from, const size_t count) noexcept {
+    if(count != 0) {
+        std::memmove(static_cast<void*>(to), static_cast<const void*>(from), count * sizeof(T));
+    }
+}
+
+// Leaves [from, from + count) as raw memory on success; on failure the
+// source is untouched.
+template<typename T>
+ADVANCED_VECTOR_CONSTEXPR void RelocateN(T* from, const size_t count, T* to) {
+    if constexpr (IsTriviallyRelocatableV<T>) {
+        if(!IsConstantEvaluated()) {
+            if(count != 0) {
+                std::memcpy(static_cast<void*>(to), static_cast<const void*>(from), count * sizeof(T));
+            }
+            return;
+        }
+    }
+    CopyOrMoveN(from, count, to);
+    std::destroy_n(from, count);
+}
+
+// Relocates `size` elements into a fresh buffer that already holds `gap` new
+// elements at to[position], leaving them between the two halves. On failure
+// the new elements are destroyed and the source is untouched.
+template<typename T>
+ADVANCED_VECTOR_CONSTEXPR void RelocateAround(T* from, const size_t size, const size_t position, T* to,
+                                              const size_t gap = 1) {
+    assert(position <= size);
+    if constexpr (IsTriviallyRelocatableV<T>) {
+        if(!IsConstantEvaluated()) {
+            RelocateN(from, position, to);
+            RelocateN(from + position, size - position, to + position + gap);
+            return;
+        }
+    }
+    ADVANCED_VECTOR_TRY {
+        CopyOrMoveN(from, position, to);
+    } ADVANCED_VECTOR_CATCH_ALL {
+        std::destroy_n(to + position, gap);
+        ADVANCED_VECTOR_RETHROW;
+    }
+    ADVANCED_VECTOR_TRY {
+        CopyOrMoveN(from + position, size - position, to + position + gap);
+    } ADVANCED_VECTOR_CATCH_ALL {
+        std::destroy_n(to, position + gap);
+        ADVANCED_VECTOR_RETHROW;
+    }
+    std::destroy_n(from, size);
+}
+
+// Constructs a new element at data[position] of a buffer with spare room for
+// at least one more element, shifting [position, size) one slot right.
+template<typename T, typename... Args>
+ADVANCED_VECTOR_CONSTEXPR void EmplaceInSpare(T* data, const size_t size, const size_t position, Args&&... args) {
+    if(position < size && IsTriviallyRelocatableV<T> && !IsConstantEvaluated()) {
+        alignas(T) unsigned char storage[sizeof(T)];
+        T* new_elem = new (storage) T(std::forward<Args>(args)...);
+        MemMoveN(data + position + 1, data + position, size - position);
+        MemMoveN(data + position, new_elem, 1);
+    } else if(position < size) {
+        T new_elem = T(std::forward<Args>(args)...);
+        ConstructAt(data + size, std::forward<T>(data[size - 1]));
+        ADVANCED_VECTOR_TRY {
+            std::move_backward(data + position, data + size - 1, data + size);
+            data[position] = std::forward<T>(new_elem);
+        } ADVANCED_VECTOR_CATCH_ALL {
+            std::destroy_at(data + size);
+            ADVANCED_VECTOR_RETHROW;
+        }
+    } else {
+        ConstructAt(data + size, std::forward<Args>(args)...);
+    }
+}
+
+// Removes data[position], shifting the tail one slot left.
+template<typename T>
+ADVANCED_VECTOR_CONSTEXPR void EraseAt(T* data, const size_t size, const size_t position) {
+    if constexpr (IsTriviallyRelocatableV<T>) {
+        if(!IsConstantEvaluated()) {
+            std::destroy_at(data + position);
+            MemMoveN(data + position, data + position + 1, size - position - 1);
+            return;
+        }
+    }
+    std::move(data + position + 1, data + size, data + position);
+    std::destroy_at(data + size - 1);
+}
+
+// Removes [position, position + count) with a single shift of the tail.
+template<typename T>
+ADVANCED_VECTOR_CONSTEXPR void EraseRangeAt(T* data, const size_t size, const size_t position, const size_t count) {
+    if(count == 0) {
+        return;
+    }
+    if constexpr (IsTriviallyRelocatableV<T>) {
+        if(!IsConstantEvaluated()) {
+            std::destroy_n(data + position, count);
+            MemMoveN(data + position, data + position + count, size - position - count);
+            return;
+        }
+    }
+    std::move(data + position + count, data + size, data + position);
+    std::destroy_n(data + size - count, count);
+}
+
+// Removes data[position] by moving the last element into its place.
+template<typename T>
+ADVANCED_VECTOR_CONSTEXPR void EraseUnorderedAt(T* data, const size_t size, const size_t position) {
+    T* const last = data + size - 1;
+    if constexpr (IsTriviallyRelocatableV<T>) {
+        if(!IsConstantEvaluated()) {
+            std::destroy_at(data + position);
+            if(data + position != last) {
+                std::memcpy(static_cast<void*>(data + position), static_cast<const void*>(last), sizeof(T));
+            }
+            return;
+        }
+    }
+    if(data + position != last) {
+        data[position] = std::move(*last);
+    }
+    std::destroy_at(last);
+}
+
+// Removes the elements matching `pred` in one pass and updates `size`. For
+// relocatable types the survivors are moved down run by run with memmove; if
+// `pred` throws, the gap is closed before rethrowing so `size` stays valid.
+template<typename T, typename Pred>
+ADVANCED_VECTOR_CONSTEXPR void RemoveIf(T* data, size_t& size, Pred& pred) {
+    if(IsTriviallyRelocatableV<T> && !IsConstantEvaluated()) {
+        size_t write = 0;
+        size_t run_start = 0;
+        size_t read = 0;
+        ADVANCED_VECTOR_TRY {
+            for(; read != size; ++read) {
+                if(pred(std::as_const(data[read]))) {
+                    MemMoveN(data + write, data + run_start, read - run_start);
+                    write += read - run_start;
+                    std::destroy_at(data + read);
+                    run_start = read + 1;
+                }
+            }
+        } ADVANCED_VECTOR_CATCH_ALL {
+            MemMoveN(data + write, data + run_start, size - run_start);
+            size = write + (size - run_start);
+            ADVANCED_VECTOR_RETHROW;
+        }
+        MemMoveN(data + write, data + run_start, size - run_start);
+        size = write + (size - run_start);
+        return;
+    }
+    T* const new_end = std::remove_if(data, data + size, [&pred](const T& elem) {
+        return pred(elem);
+    });
+    std::destroy(new_end, data + size);
+    size = static_cast<size_t>(new_end - data);
+}
+
+// Inserts `count` copies of [first, first + count) at data[position] of a
+// buffer with room for them, moving [position, size) only once.
+template<typename T, typename ForwardIt>
+ADVANCED_VECTOR_CONSTEXPR void InsertRangeInSpare(T* data, const size_t size, const size_t position, ForwardIt first,
+                                                  const size_t count) {
+    if(count == 0) {
+        return;
+    }
+    T* pos = data + position;
+    const size_t elems_after = size - position;
+    if(IsTriviallyRelocatableV<T> && !IsConstantEvaluated()) {
+        MemMoveN(pos + count, pos, elems_after);
+        ADVANCED_VECTOR_TRY {
+            std::uninitialized_copy_n(first, count, pos);
+        } ADVANCED_VECTOR_CATCH_ALL {
+            MemMoveN(pos, pos + count, elems_after);
+            ADVANCED_VECTOR_RETHROW;
+        }
+    } else if(elems_after > count) {
+        UninitializedCopyN(std::make_move_iterator(data + size - count), count, data + size);
+        std::move_backward(pos, data + size - count, data + size);
+        std::copy_n(first, count, pos);
+    } else {
+        ForwardIt mid = std::next(first, elems_after);
+        UninitializedCopyN(mid, count - elems_after, data + size);
+        ADVANCED_VECTOR_TRY {
+            UninitializedCopyN(std::make_move_iterator(pos), elems_after, pos + count);
+        } ADVANCED_VECTOR_CATCH_ALL {
+            std::destroy_n(data + size, count - elems_after);
+            ADVANCED_VECTOR_RETHROW;
+        }
+        std::copy_n(first, elems_after, pos);
+    }
+}
+
+// Relocates [from, from + count) to data[position] of a buffer with room for
+// them, moving [position, size) only once. Unless T is trivially relocatable
+// the elements are moved and then destroyed, so on failure the source is
+// left valid but unspecified.
+template<typename T>
+ADVANCED_VECTOR_CONSTEXPR void SpliceInSpare(T* data, const size_t size, const size_t position, T* from,
+                                             const size_t count) {
+    if constexpr (IsTriviallyRelocatableV<T>) {
+        if(!IsConstantEvaluated()) {
+            MemMoveN(data + position + count, data + position, size - position);
+            MemMoveN(data + position, from, count);
+            return;
+        }
+    }
+    InsertRangeInSpare(data, size, position, std::make_move_iterator(from), count);
+    std::destroy_n(from, count);
+}
+
+// Forward iterator over `count` repetitions of one value, used by the fill
+// overloads to share the range insertion code.
+template<typename T>
+class RepeatIterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T*;
+    using reference = const T&;
+
+    constexpr RepeatIterator(const T& value, const difference_type index) noexcept
+    : value_(&value)
+    , index_(index) {
+    }
+
+    constexpr reference operator*() const noexcept {
+        return *value_;
+    }
+
+    constexpr pointer operator->() const noexcept {
+        return value_;
+    }
+
+    constexpr RepeatIterator& operator++() noexcept {
+        ++index_;
+        return *this;
+    }
+
+    constexpr RepeatIterator operator++(int) noexcept {
+        RepeatIterator old = *this;
+        ++index_;
+        return old;
+    }
+
+    constexpr bool operator==(const RepeatIterator& other) const noexcept {
+        return index_ == other.index_;
+    }
+
+    constexpr bool operator!=(const RepeatIterator& other) const noexcept {
+        return index_ != other.index_;
+    }
+
+private:
+    const T* value_;
+    difference_type index_;
+};
+
+template<typename It>
+using RequireInputIterator = std::enable_if_t<
+    std::is_convertible_v<typename std::iterator_traits<It>::iterator_category, std::input_iterator_tag>>;
+
+template<typename It>
+inline constexpr bool IsForwardIteratorV =
+    std::is_convertible_v<typename std::iterator_traits<It>::iterator_category, std::forward_iterator_tag>;
+
+}  // namespace detail
+
+// Instrumentation policies observe every buffer a Vector obtains or gives up:
+//   OnReallocate(old_capacity, new_capacity, relocated, elem_size)
+//       the vector moved to a new buffer (old_capacity == 0 for the first
+//       one), relocating `relocated` elements into it;
+//   OnRelease(size, capacity, elem_size)
+//       the vector is done with its buffer, e.g. on destruction;
+//   OnTransfer(old_capacity, new_capacity, elem_size)
+//       move assignment or Swap exchanged buffers with another vector
+//       without allocating; each side reports what it gave up and got.
+// NoInstrumentation is the default and compiles to nothing.
+struct NoInstrumentation {
+    constexpr void OnReallocate(size_t /*old_capacity*/, size_t /*new_capacity*/, size_t /*relocated*/,
+                                size_t /*elem_size*/) noexcept {
+    }
+
+    constexpr void OnRelease(size_t /*size*/, size_t /*capacity*/, size_t /*elem_size*/) noexcept {
+    }
+
+    constexpr void OnTransfer(size_t /*old_capacity*/, size_t /*new_capacity*/, size_t /*elem_size*/) noexcept {
+    }
+};
+
+// Per-instance counters, read through Vector::GetInstrumentation().
+struct VectorStats {
+    size_t reallocations = 0;
+    size_t bytes_allocated = 0;
+    size_t elements_relocated = 0;
+    size_t peak_capacity = 0;
+    size_t wasted_bytes_at_release = 0;
+
+    void OnReallocate(size_t /*old_capacity*/, const size_t new_capacity, const size_t relocated,
+                      const size_t elem_size) noexcept {
+        ++reallocations;
+        bytes_allocated += new_capacity * elem_size;
+        elements_relocated += relocated;
+        peak_capacity = std::max(peak_capacity, new_capacity);
+    }
+
+    void OnRelease(const size_t size, const size_t capacity, const size_t elem_size) noexcept {
+        wasted_bytes_at_release += (capacity - size) * elem_size;
+    }
+
+    // Nothing was allocated or released.
+    void OnTransfer(size_t /*old_capacity*/, size_t /*new_capacity*/, size_t /*elem_size*/) noexcept {
+    }
+};
+
+struct VectorEvent {
+    enum class Kind {
+        REALLOCATE,
+        RELEASE,
+    };
+
+    Kind kind;
+    size_t old_capacity;
+    size_t new_capacity;
+    // Relocated elements for REALLOCATE, live elements for RELEASE.
+    size_t elements;
+    size_t elem_size;
+};
+
+// Forwards every event to one process-wide callback, e.g. to feed a metrics
+// system. Events are dropped while no callback is registered.
+struct CallbackInstrumentation {
+    using Callback = void (*)(const VectorEvent& event) noexcept;
+
+    static void SetCallback(const Callback callback) noexcept {
+        callback_.store(callback, std::memory_order_release);
+    }
+
+    void OnReallocate(const size_t old_capacity, const size_t new_capacity, const size_t relocated,
+                      const size_t elem_size) noexcept {
+        Notify({VectorEvent::Kind::REALLOCATE, old_capacity, new_capacity, relocated, elem_size});
+    }
+
+    void OnRelease(const size_t size, const size_t capacity, const size_t elem_size) noexcept {
+        Notify({VectorEvent::Kind::RELEASE, capacity, 0, size, elem_size});
+    }
+
+    void OnTransfer(size_t /*old_capacity*/, size_t /*new_capacity*/, size_t /*elem_size*/) noexcept {
+    }
+
+private:
+    static inline std::atomic<Callback> callback_{nullptr};
+
+    static void Notify(const VectorEvent& event) noexcept {
+        if(const Callback callback = callback_.load(std::memory_order_acquire)) {
+            callback(event);
+        }
+    }
+};
+
+// Opts bulk construction, copying and relocation into running on several
+// threads. Inputs shorter than 2 * min_chunk elements stay on the calling
+// thread; max_threads == 0 means std::thread::hardware_concurrency().
+struct ParallelPolicy {
+    size_t max_threads = 0;
+    size_t min_chunk = size_t{1} << 16;
+
+    [[nodiscard]] size_t ChunkCount(const size_t count) const noexcept {
+        if(min_chunk == 0 || count / min_chunk < 2) {
+            return 1;
+        }
+        const size_t threads = max_threads != 0 ? max_threads
+                                                : std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        return std::min(threads, count / min_chunk);
+    }
+};
+
+inline constexpr ParallelPolicy PARALLEL{};
+
+namespace detail {
+
+// Calls op(first, last) for contiguous chunks of [0, count), one thread per
+// chunk. If any chunk throws, undo(first, last) is called for every chunk
+// that succeeded and the first exception is rethrown, so an `op` that cleans
+// up after itself keeps the whole operation all-or-nothing.
+template<typename Op, typename Undo>
+void ParallelFor(const ParallelPolicy& policy, const size_t count, Op op, Undo undo) {
+    const size_t chunks = policy.ChunkCount(count);
+    if(chunks <= 1) {
+        op(size_t{0}, count);
+        return;
+    }
+
+    const auto bound = [count, chunks](const size_t chunk) {
+        return count / chunks * chunk + std::min(chunk, count % chunks);
+    };
+    auto errors = std::make_unique<std::exception_ptr[]>(chunks);
+    const auto run = [&](const size_t chunk) noexcept {
+        ADVANCED_VECTOR_TRY {
+            op(bound(chunk), bound(chunk + 1));
+        } ADVANCED_VECTOR_CATCH_ALL {
+            errors[chunk] = std::current_exception();
+        }
+    };
+
+    auto threads = std::make_unique<std::thread[]>(chunks);
+    for(size_t chunk = 1; chunk < chunks; ++chunk) {
+        ADVANCED_VECTOR_TRY {
+            threads[chunk] = std::thread(run, chunk);
+        } ADVANCED_VECTOR_CATCH_ALL {
+            run(chunk);
+        }
+    }
+    run(0);
+    for(size_t chunk = 1; chunk < chunks; ++chunk) {
+        if(threads[chunk].joinable()) {
+            threads[chunk].join();
+        }
+    }
+
+    std::exception_ptr first_error;
+    for(size_t chunk = 0; chunk < chunks; ++chunk) {
+        if(errors[chunk] && !first_error) {
+            first_error = errors[chunk];
+        }
+    }
+    if(first_error) {
+        for(size_t chunk = 0; chunk < chunks; ++chunk) {
+            if(!errors[chunk]) {
+                undo(bound(chunk), bound(chunk + 1));
+            }
+        }
+        std::rethrow_exception(first_error);
+    }
+}
+
+}  // namespace detail
+
+// Selects constructors that default-initialize the elements instead of
+// value-initializing them.
+struct DefaultInitTag {
+    explicit DefaultInitTag() = default;
+};
+
+inline constexpr DefaultInitTag DEFAULT_INIT{};
+
+// Selects the constructor that takes over an existing buffer.
+struct AdoptTag {
+    explicit AdoptTag() = default;
+};
+
+inline constexpr AdoptTag ADOPT{};
+
+template<typename T, typename Allocator = std::allocator<T>, typename GrowthPolicy = DoublingGrowthPolicy,
+         typename Instrumentation = NoInstrumentation>
+class Vector {
+    using AllocTraits = std::allocator_traits<Allocator>;
+
 public:
-    RawMemory() = default;
 
-    explicit RawMemory(const size_t count) 
-    : buffer_(Allocate(count)) 
-    , capacity_(count) {
-    }
+    using value_type = T;
+    using allocator_type = Allocator;
+    using iterator = detail::hardening::Iterator<T>;
+    using const_iterator = detail::hardening::Iterator<const T>;
 
-    RawMemory(const RawMemory&) = delete;
+    Vector() = default;
 
-    RawMemory(RawMemory&& other) noexcept 
-    : buffer_(std::exchange(other.buffer_, nullptr)) 
-    , capacity_(std::exchange(other.capacity_, 0)) {
+    ADVANCED_VECTOR_CONSTEXPR explicit Vector(const Allocator& alloc) noexcept
+    : data_(alloc) {
     }
 
-    ~RawMemory() {
-        Deallocate(buffer_);
+    // Starts out with a given Instrumentation instead of a default-constructed
+    // one, e.g. to tell a profiler where the vector was created.
+    explicit Vector(Instrumentation instrumentation, const Allocator& alloc = Allocator()) noexcept
+    : data_(alloc)
+    , instrumentation_(std::move(instrumentation)) {
     }
 
-    [[nodiscard]] size_t Capacity() const noexcept {
-        return capacity_;
+    ADVANCED_VECTOR_CONSTEXPR explicit Vector(const size_t count, const Allocator& alloc = Allocator()) 
+    : data_(count, alloc)
+    , size_(count) {
+        detail::UninitializedValueConstructN(data_.GetAddress(), count);
+        ReportInitialStorage();
     }
 
-    const T* GetAddress() const noexcept {
-        return buffer_;
+    ADVANCED_VECTOR_CONSTEXPR Vector(const size_t count, DefaultInitTag, const Allocator& alloc = Allocator()) 
+    : data_(count, alloc)
+    , size_(count) {
+        detail::UninitializedDefaultConstructN(data_.GetAddress(), count);
+        ReportInitialStorage();
     }
-    
-    T* GetAddress() noexcept {
-        return buffer_;
+
+    Vector(const ParallelPolicy& policy, const size_t count, const Allocator& alloc = Allocator()) 
+    : data_(count, alloc)
+    , size_(count) {
+        T* const buffer = data_.GetAddress();
+        detail::ParallelFor(policy, count, [buffer](const size_t first, const size_t last) {
+            std::uninitialized_value_construct_n(buffer + first, last - first);
+        }, [buffer](const size_t first, const size_t last) {
+            std::destroy_n(buffer + first, last - first);
+        });
+        ReportInitialStorage();
     }
 
-    const T& operator[](const size_t index) const noexcept {
-        return const_cast<RawMemory&>(*this)[index];
+    Vector(const ParallelPolicy& policy, const Vector& other) 
+    : data_(other.size_, AllocTraits::select_on_container_copy_construction(other.data_.GetAllocator()))
+    , size_(other.size_) {
+        const T* const source = other.data_.GetAddress();
+        T* const buffer = data_.GetAddress();
+        detail::ParallelFor(policy, size_, [source, buffer](const size_t first, const size_t last) {
+            std::uninitialized_copy_n(source + first, last - first, buffer + first);
+        }, [buffer](const size_t first, const size_t last) {
+            std::destroy_n(buffer + first, last - first);
+        });
+        ReportInitialStorage();
     }
 
-    T& operator[](const size_t index) noexcept {
-        assert(index < capacity_);
-        return buffer_[index];
+    // `data` must come from `alloc` with room for `capacity` elements, of which
+    // the first `size` are constructed.
+    Vector(AdoptTag, T* data, const size_t size, const size_t capacity, const Allocator& alloc = Allocator()) noexcept
+    : data_(data, capacity, alloc)
+    , size_(size) {
+        assert(size <= capacity);
+        assert(data != nullptr || capacity == 0);
+        ReportInitialStorage();
     }
 
-    const T* operator+(const size_t offset) const noexcept {
-        return const_cast<RawMemory&>(*this) + offset; 
+    explicit Vector(BufferPtr<T, Allocator>&& buffer) noexcept
+    : Vector(ADOPT, buffer.get(), buffer.get_deleter().Size(), buffer.get_deleter().Capacity(),
+             buffer.get_deleter().GetAllocator()) {
+        buffer.release();
     }
 
-    T* operator+(const size_t offset) noexcept {
-        assert(offset <= capacity_);
-        return buffer_ + offset;
+    template<typename InputIt, typename = detail::RequireInputIterator<InputIt>>
+    ADVANCED_VECTOR_CONSTEXPR Vector(InputIt first, InputIt last, const Allocator& alloc = Allocator())
+    : data_(alloc) {
+        if constexpr (detail::IsForwardIteratorV<InputIt>) {
+            const size_t count = static_cast<size_t>(std::distance(first, last));
+            RawMemory<T, Allocator> new_data(count, alloc);
+            detail::UninitializedCopyN(first, count, new_data.GetAddress());
+            SwapStorage(new_data, 0);
+            size_ = count;
+        } else {
+            for(; first != last; ++first) {
+                EmplaceBack(*first);
+            }
+        }
     }
 
-    RawMemory& operator=(const RawMemory&) = delete;
+    ADVANCED_VECTOR_CONSTEXPR Vector(const Vector& other) 
+    : Vector(other, AllocTraits::select_on_container_copy_construction(other.data_.GetAllocator())) {
+    }
 
-    RawMemory& operator=(RawMemory&& other) noexcept {
-        if(this != &other) {
-            this->buffer_ = std::exchange(other.buffer_, nullptr);
-            this->capacity_ = std::exchange(other.capacity_, 0);
-        }
-        return *this;
+    ADVANCED_VECTOR_CONSTEXPR Vector(const Vector& other, const Allocator& alloc) 
+    : data_(other.size_, alloc)
+    , size_(other.size_) {
+        detail::UninitializedCopyN(other.data_.GetAddress(), other.size_, data_.GetAddress());
+        ReportInitialStorage();
     }
- 
-    void Swap(RawMemory& other) noexcept {
-        std::swap(buffer_, other.buffer_);
-        std::swap(capacity_, other.capacity_);
+
+    ADVANCED_VECTOR_CONSTEXPR Vector(Vector&& other) noexcept 
+    : data_(std::move(other.data_))
+    , size_(std::exchange(other.size_, 0))
+    , instrumentation_(std::move(other.instrumentation_)) {
+        other.generation_.Bump();
     }
 
-private:
-    T* buffer_ = nullptr;
-    size_t capacity_ = 0;
+    ADVANCED_VECTOR_CONSTEXPR ~Vector() {
+        DestroyN(data_.GetAddress(), size_);
+        ReleaseStorage();
+    }
 
-    static T* Allocate(const size_t count) {
-        return count != 0 ? static_cast<T*>(operator new(count * sizeof(T))) : nullptr; 
+    [[nodiscard]] ADVANCED_VECTOR_CONSTEXPR allocator_type GetAllocator() const noexcept {
+        return data_.GetAllocator();
     }
 
-    static void Deallocate(T* buff) noexcept {
-        operator delete(buff);
-    } 
-};
+    [[nodiscard]] const Instrumentation& GetInstrumentation() const noexcept {
+        return instrumentation_;
+    }
 
-template<typename T>
-class Vector {
-public:
+    ADVANCED_VECTOR_CONSTEXPR iterator begin() noexcept {
+        return MakeIterator(0);
+    }
 
-    using iterator = T*;
-    using const_iterator = const T*;
+    ADVANCED_VECTOR_CONSTEXPR const_iterator cbegin() const noexcept {
+        return MakeIterator(0);
+    }
 
-    Vector() = default;
+    ADVANCED_VECTOR_CONSTEXPR const_iterator begin() const noexcept {
+        return cbegin();
+    }
 
-    explicit Vector(const size_t count) 
-    : data_(count)
-    , size_(count) {
-        std::uninitialized_value_construct_n(data_.GetAddress(), count);
+    ADVANCED_VECTOR_CONSTEXPR iterator end() noexcept {
+        return MakeIterator(size_);
     }
 
-    Vector(const Vector& other) 
-    : data_(other.size_)
-    , size_(other.size_) {
-        std::uninitialized_copy_n(other.data_.GetAddress(), other.size_, data_.GetAddress());
+    ADVANCED_VECTOR_CONSTEXPR const_iterator cend() const noexcept {
+        return MakeIterator(size_);
     }
 
-    Vector(Vector&& other) noexcept 
-    : data_(std::move(other.data_))
-    , size_(std::exchange(other.size_, 0)) {
+    ADVANCED_VECTOR_CONSTEXPR const_iterator end() const noexcept {
+        return cend();
     }
 
-    ~Vector() {
-        DestroyN(data_.GetAddress(), size_);
+
+    [[nodiscard]] ADVANCED_VECTOR_CONSTEXPR size_t Capacity() const noexcept {
+        return data_.Capacity();
+    }
+    
+    [[nodiscard]] ADVANCED_VECTOR_CONSTEXPR size_t Size() const noexcept {
+        return size_;
     }
 
-    iterator begin() noexcept {
+    ADVANCED_VECTOR_CONSTEXPR T* Data() noexcept {
         return data_.GetAddress();
     }
 
-    const_iterator cbegin() const noexcept {
+    ADVANCED_VECTOR_CONSTEXPR const T* Data() const noexcept {
         return data_.GetAddress();
     }
 
-    const_iterator begin() const noexcept {
-        return cbegin();
+    ADVANCED_VECTOR_CONSTEXPR T& Front() noexcept {
+        ADVANCED_VECTOR_CHECK(size_ > 0, "Front() on an empty vector");
+        return data_[0];
     }
 
-    iterator end() noexcept {
-        return data_ + size_;
+    ADVANCED_VECTOR_CONSTEXPR const T& Front() const noexcept {
+        return const_cast<Vector&>(*this).Front();
     }
 
-    const_iterator cend() const noexcept {
-        return data_ + size_;
+    ADVANCED_VECTOR_CONSTEXPR T& Back() noexcept {
+        ADVANCED_VECTOR_CHECK(size_ > 0, "Back() on an empty vector");
+        return data_[size_ - 1];
     }
 
-    const_iterator end() const noexcept {
-        return cend();
+    ADVANCED_VECTOR_CONSTEXPR const T& Back() const noexcept {
+        return const_cast<Vector&>(*this).Back();
     }
 
+    // Searches and reductions over the elements. Arithmetic T goes through
+    // the vectorized kernels of simd.h.
+    [[nodiscard]] iterator Find(const T& value) {
+        return begin() + detail::simd::Find(data_.GetAddress(), size_, value);
+    }
 
-    [[nodiscard]] size_t Capacity() const noexcept {
-        return data_.Capacity();
+    [[nodiscard]] const_iterator Find(const T& value) const {
+        return const_cast<Vector&>(*this).Find(value);
     }
-    
-    [[nodiscard]] size_t Size() const noexcept {
-        return size_;
+
+    [[nodiscard]] size_t Count(const T& value) const {
+        return detail::simd::Count(data_.GetAddress(), size_, value);
+    }
+
+    void Fill(const T& value) {
+        std::fill_n(data_.GetAddress(), size_, value);
+    }
+
+    // The vector must not be empty.
+    [[nodiscard]] T Min() const {
+        assert(size_ > 0);
+        return detail::simd::MinMax<false>(data_.GetAddress(), size_);
     }
 
-    void Reserve(const size_t new_capacity) {
+    [[nodiscard]] T Max() const {
+        assert(size_ > 0);
+        return detail::simd::MinMax<true>(data_.GetAddress(), size_);
+    }
+
+    [[nodiscard]] T Sum() const {
+        return detail::simd::Sum(data_.GetAddress(), size_);
+    }
+
+#ifdef __cpp_lib_span
+    operator std::span<T>() noexcept {
+        return {data_.GetAddress(), size_};
+    }
+
+    operator std::span<const T>() const noexcept {
+        return {data_.GetAddress(), size_};
+    }
+#endif
+
+    ADVANCED_VECTOR_CONSTEXPR void Reserve(const size_t new_capacity) {
         if(new_capacity <= data_.Capacity()) {
             return;
         }
 
-        RawMemory<T> new_data(new_capacity);
+        if constexpr (IsTriviallyRelocatableV<T>) {
+            const size_t old_capacity = data_.Capacity();
+            if(data_.TryExpand(new_capacity)) {
+                instrumentation_.OnReallocate(old_capacity, new_capacity, 0, sizeof(T));
+                generation_.Bump();
+                return;
+            }
+        }
 
-        CopyOrMove(data_.GetAddress(), new_data.GetAddress(), size_);
+        ReallocateTo(new_capacity);
+    }
 
-        std::destroy_n(data_.GetAddress(), size_);
-        data_.Swap(new_data);
+    void Reserve(const ParallelPolicy& policy, const size_t new_capacity) {
+        if(new_capacity <= data_.Capacity()) {
+            return;
+        }
+
+        if constexpr (IsTriviallyRelocatableV<T>) {
+            const size_t old_capacity = data_.Capacity();
+            if(data_.TryExpand(new_capacity)) {
+                instrumentation_.OnReallocate(old_capacity, new_capacity, 0, sizeof(T));
+                generation_.Bump();
+                return;
+            }
+        }
+
+        RawMemory<T, Allocator> new_data(new_capacity, data_.GetAllocator());
+        T* const source = data_.GetAddress();
+        T* const buffer = new_data.GetAddress();
+        if constexpr (IsTriviallyRelocatableV<T>) {
+            detail::ParallelFor(policy, size_, [source, buffer](const size_t first, const size_t last) {
+                detail::RelocateN(source + first, last - first, buffer + first);
+            }, [](size_t, size_t) {
+            });
+        } else {
+            detail::ParallelFor(policy, size_, [source, buffer](const size_t first, const size_t last) {
+                detail::CopyOrMoveN(source + first, last - first, buffer + first);
+            }, [buffer](const size_t first, const size_t last) {
+                std::destroy_n(buffer + first, last - first);
+            });
+            detail::ParallelFor(policy, size_, [source](const size_t first, const size_t last) {
+                std::destroy_n(source + first, last - first);
+            }, [](size_t, size_t) {
+            });
+        }
+
+        SwapStorage(new_data, size_);
+    }
+
+    void Resize(const ParallelPolicy& policy, const size_t new_size) {
+        if(new_size <= size_) {
+            Resize(new_size);
+            return;
+        }
+        Reserve(policy, new_size);
+        T* const tail = data_.GetAddress() + size_;
+        detail::ParallelFor(policy, new_size - size_, [tail](const size_t first, const size_t last) {
+            std::uninitialized_value_construct_n(tail + first, last - first);
+        }, [tail](const size_t first, const size_t last) {
+            std::destroy_n(tail + first, last - first);
+        });
+        size_ = new_size;
+    }
+
+    // The Try* members report a failed allocation as
+    // VectorStatus::ALLOCATION_FAILED and leave the vector unchanged instead
+    // of throwing, so they also work in builds without exceptions.
+    VectorStatus TryReserve(const size_t new_capacity) {
+        if(new_capacity <= data_.Capacity()) {
+            return VectorStatus::OK;
+        }
+        if constexpr (IsTriviallyRelocatableV<T>) {
+            const size_t old_capacity = data_.Capacity();
+            if(data_.TryExpand(new_capacity)) {
+                instrumentation_.OnReallocate(old_capacity, new_capacity, 0, sizeof(T));
+                generation_.Bump();
+                return VectorStatus::OK;
+            }
+        }
+        return TryReallocateTo(new_capacity) ? VectorStatus::OK : VectorStatus::ALLOCATION_FAILED;
+    }
+
+    VectorStatus TryResize(const size_t new_size) {
+        if(new_size > size_) {
+            if(TryReserve(new_size) != VectorStatus::OK) {
+                return VectorStatus::ALLOCATION_FAILED;
+            }
+            detail::UninitializedValueConstructN(data_.GetAddress() + size_, new_size - size_);
+            size_ = new_size;
+        } else {
+            Resize(new_size);
+        }
+        return VectorStatus::OK;
     }
 
-    void Resize(const size_t new_size) {
-        if(data_.Capacity() > new_size) {
-            if(new_size < size_) {
-                std::destroy_n(data_.GetAddress() + new_size, size_ - new_size);
-            } else if(new_size > size_) {
-                std::uninitialized_default_construct_n(data_.GetAddress() + size_, new_size - size_);
+    template<typename Type>
+    VectorStatus TryPushBack(Type&& elem) {
+        return TryEmplaceBack(std::forward<Type>(elem));
+    }
+
+    template<typename... Args>
+    VectorStatus TryEmplaceBack(Args&&... args) {
+        if(size_ == data_.Capacity()) {
+            RawMemory<T, Allocator> new_data(data_.GetAllocator());
+            if(!new_data.TryAllocate(GrowCapacity(size_ + 1))) {
+                return VectorStatus::ALLOCATION_FAILED;
             }
-        } else if (data_.Capacity() < new_size) {
+            detail::ConstructAt(new_data + size_, std::forward<Args>(args)...);
+            detail::RelocateAround(data_.GetAddress(), size_, size_, new_data.GetAddress());
+            SwapStorage(new_data, size_);
+        } else {
+            detail::ConstructAt(data_ + size_, std::forward<Args>(args)...);
+        }
+        ++size_;
+        return VectorStatus::OK;
+    }
+
+    ADVANCED_VECTOR_CONSTEXPR void ShrinkToFit() {
+        if(size_ != data_.Capacity()) {
+            ReallocateTo(size_);
+        }
+    }
+
+    ADVANCED_VECTOR_CONSTEXPR void Resize(const size_t new_size) {
+        if(new_size < size_) {
+            std::destroy_n(data_.GetAddress() + new_size, size_ - new_size);
+            size_ = new_size;
+            generation_.Bump();
+            ReleaseUnusedCapacity();
+        } else if(new_size > size_) {
+            Reserve(new_size);
+            detail::UninitializedValueConstructN(data_.GetAddress() + size_, new_size - size_);
+            size_ = new_size;
+        }
+    }
+
+    // Like Resize, but new elements are default-initialized, so trivial types
+    // are left with indeterminate values instead of being zeroed.
+    ADVANCED_VECTOR_CONSTEXPR void ResizeDefaultInit(const size_t new_size) {
+        if(new_size < size_) {
+            std::destroy_n(data_.GetAddress() + new_size, size_ - new_size);
+            size_ = new_size;
+            generation_.Bump();
+            ReleaseUnusedCapacity();
+        } else if(new_size > size_) {
             Reserve(new_size);
-            std::uninitialized_default_construct_n(data_.GetAddress() + size_, new_size - size_);
+            detail::UninitializedDefaultConstructN(data_.GetAddress() + size_, new_size - size_);
+            size_ = new_size;
         }
+    }
+
+    // Counterpart of std::string::resize_and_overwrite: makes room for
+    // `count` elements and calls op(data, count), which fills the buffer and
+    // returns the new size (at most `count`). Elements past the old size are
+    // handed to `op` uninitialized.
+    template<typename Operation>
+    void ResizeForOverwrite(const size_t count, Operation op) {
+        static_assert(std::is_trivially_default_constructible_v<T> && std::is_trivially_destructible_v<T>,
+                      "ResizeForOverwrite needs elements that may stay uninitialized");
+        Reserve(count);
+        const size_t new_size = static_cast<size_t>(std::move(op)(data_.GetAddress(), count));
+        assert(new_size <= count);
         size_ = new_size;
+        generation_.Bump();
     }
 
     template<typename Type>
-    void PushBack(Type&& elem) {
+    ADVANCED_VECTOR_CONSTEXPR void PushBack(Type&& elem) {
         Emplace(cend(), std::forward<Type>(elem));
     }
 
-    void PopBack() noexcept {
-        assert(size_ > 0);
+    ADVANCED_VECTOR_CONSTEXPR void PopBack() noexcept {
+        ADVANCED_VECTOR_CHECK(size_ > 0, "PopBack() on an empty vector");
         std::destroy_at(data_.GetAddress() + (size_ - 1));
         --size_;
+        generation_.Bump();
+        ReleaseUnusedCapacity();
     }
 
     template<typename... Args>
-    iterator Emplace(const_iterator pos, Args&&... args) {
+    ADVANCED_VECTOR_CONSTEXPR iterator Emplace(const_iterator pos, Args&&... args) {
+        generation_.CheckIterator(pos);
         size_t position = pos - begin();
         if(size_ == data_.Capacity()) {
             EmplaceWithAllocate(position, std::forward<Args>(args)...);
         } else {
-            EmplaceWithoutAllocate(position, std::forward<Args>(args)...);
+            detail::EmplaceInSpare(data_.GetAddress(), size_, position, std::forward<Args>(args)...);
+            if(position != size_) {
+                generation_.Bump();
+            }
         }
         ++size_;
         return begin() + position;
     }
 
     template<typename... Args>
-    T& EmplaceBack(Args&&... args) {
+    ADVANCED_VECTOR_CONSTEXPR T& EmplaceBack(Args&&... args) {
         return *Emplace(cend(), std::forward<Args>(args)...);
     }
 
-    iterator Insert(const_iterator pos, const T& elem) {
+    ADVANCED_VECTOR_CONSTEXPR iterator Insert(const_iterator pos, const T& elem) {
         return Emplace(pos, elem);
     }
 
-    iterator Insert(const_iterator pos, T&& elem) {
+    ADVANCED_VECTOR_CONSTEXPR iterator Insert(const_iterator pos, T&& elem) {
         return Emplace(pos, std::move(elem));
     }
 
-    iterator Erase(const_iterator pos) {
-        assert(pos < end() && pos >= begin());
-        size_t position = pos - begin();
-        if(position == size_) {
-            std::destroy_at(data_ + size_ - 1);
-            --size_;
+    ADVANCED_VECTOR_CONSTEXPR iterator Insert(const_iterator pos, const size_t count, const T& elem) {
+        generation_.CheckIterator(pos);
+        const size_t position = pos - begin();
+        if(size_ + count <= data_.Capacity()) {
+            const T copy(elem);
+            return InsertRange(position, detail::RepeatIterator<T>(copy, 0), count);
+        }
+        return InsertRange(position, detail::RepeatIterator<T>(elem, 0), count);
+    }
+
+    template<typename InputIt, typename = detail::RequireInputIterator<InputIt>>
+    ADVANCED_VECTOR_CONSTEXPR iterator Insert(const_iterator pos, InputIt first, InputIt last) {
+        generation_.CheckIterator(pos);
+        const size_t position = pos - begin();
+        if constexpr (detail::IsForwardIteratorV<InputIt>) {
+            return InsertRange(position, first, static_cast<size_t>(std::distance(first, last)));
+        } else {
+            const size_t old_size = size_;
+            for(; first != last; ++first) {
+                EmplaceBack(*first);
+            }
+            std::rotate(data_ + position, data_ + old_size, data_ + size_);
+            if(position != old_size) {
+                generation_.Bump();
+            }
+            return begin() + position;
+        }
+    }
+
+    template<typename Range>
+    ADVANCED_VECTOR_CONSTEXPR void Append(Range&& range) {
+        using std::begin;
+        using std::end;
+        if constexpr (std::is_lvalue_reference_v<Range>) {
+            Insert(cend(), begin(range), end(range));
+        } else {
+            Insert(cend(), std::make_move_iterator(begin(range)), std::make_move_iterator(end(range)));
+        }
+    }
+
+    // Moves all elements of `other` into this vector at `pos` and leaves
+    // `other` empty, with at most one new buffer for the result. An empty
+    // vector without room for them takes over the buffer of `other` instead.
+    ADVANCED_VECTOR_CONSTEXPR iterator Splice(const_iterator pos, Vector&& other) {
+        generation_.CheckIterator(pos);
+        ADVANCED_VECTOR_CHECK(pos <= end() && pos >= begin(), "Splice() position out of range");
+        assert(this != &other);
+        const size_t position = pos - begin();
+        const size_t count = other.size_;
+        if(count == 0) {
+            return begin() + position;
+        }
+        if(size_ == 0 && data_.Capacity() < count
+           && (AllocTraits::is_always_equal::value || data_.GetAllocator() == other.data_.GetAllocator())) {
+            MoveStorageFrom(other);
+            return begin();
+        }
+        T* const source = other.data_.GetAddress();
+        if(size_ + count <= data_.Capacity()) {
+            detail::SpliceInSpare(data_.GetAddress(), size_, position, source, count);
+            if(position != size_) {
+                generation_.Bump();
+            }
         } else {
-            std::move(data_ + position + 1, data_ + size_, data_ + position);
-            std::destroy_at(data_ + size_ - 1);
-            --size_;
+            RawMemory<T, Allocator> temp(GrowCapacity(size_ + count), data_.GetAllocator());
+            // Copied rather than relocated if moving may throw, so a failure
+            // while relocating this vector leaves `other` intact.
+            if constexpr (IsTriviallyRelocatableV<T>) {
+                detail::RelocateN(source, count, temp + position);
+            } else {
+                detail::CopyOrMoveN(source, count, temp + position);
+            }
+            detail::RelocateAround(data_.GetAddress(), size_, position, temp.GetAddress(), count);
+            if constexpr (!IsTriviallyRelocatableV<T>) {
+                std::destroy_n(source, count);
+            }
+            SwapStorage(temp, size_);
+        }
+        size_ += count;
+        other.size_ = 0;
+        other.generation_.Bump();
+        return begin() + position;
+    }
+
+    // Appends the elements of `other` without copying them; see Splice.
+    ADVANCED_VECTOR_CONSTEXPR void Append(Vector&& other) {
+        Splice(cend(), std::move(other));
+    }
+
+    // Moves [pos, end()) into a new vector with a buffer of exactly that size
+    // and returns it. Splitting at begin() hands over the whole buffer.
+    [[nodiscard]] ADVANCED_VECTOR_CONSTEXPR Vector Split(const_iterator pos) {
+        generation_.CheckIterator(pos);
+        ADVANCED_VECTOR_CHECK(pos <= end() && pos >= begin(), "Split() position out of range");
+        const size_t position = pos - begin();
+        Vector tail(data_.GetAllocator());
+        if(position == 0) {
+            tail.MoveStorageFrom(*this);
+            return tail;
+        }
+        const size_t count = size_ - position;
+        if(count != 0) {
+            RawMemory<T, Allocator> buffer(count, data_.GetAllocator());
+            detail::RelocateN(data_ + position, count, buffer.GetAddress());
+            tail.SwapStorage(buffer, 0);
+            tail.size_ = count;
+            size_ = position;
+            generation_.Bump();
+            ReleaseUnusedCapacity();
         }
+        return tail;
+    }
+
+    ADVANCED_VECTOR_CONSTEXPR iterator Erase(const_iterator pos) {
+        generation_.CheckIterator(pos);
+        ADVANCED_VECTOR_CHECK(pos < end() && pos >= begin(), "Erase() position out of range");
+        size_t position = pos - begin();
+        detail::EraseAt(data_.GetAddress(), size_, position);
+        --size_;
+        generation_.Bump();
+        ReleaseUnusedCapacity();
+        return begin() + position;
+    }
+
+    // O(1) erase that does not keep the order: the last element takes the
+    // place of `pos`.
+    ADVANCED_VECTOR_CONSTEXPR iterator EraseUnordered(const_iterator pos) {
+        generation_.CheckIterator(pos);
+        ADVANCED_VECTOR_CHECK(pos < end() && pos >= begin(), "EraseUnordered() position out of range");
+        size_t position = pos - begin();
+        detail::EraseUnorderedAt(data_.GetAddress(), size_, position);
+        --size_;
+        generation_.Bump();
+        ReleaseUnusedCapacity();
+        return begin() + position;
+    }
+
+    ADVANCED_VECTOR_CONSTEXPR iterator EraseRange(const_iterator first, const_iterator last) {
+        generation_.CheckIterator(first);
+        generation_.CheckIterator(last);
+        ADVANCED_VECTOR_CHECK(first <= last && first >= begin() && last <= end(), "EraseRange() range out of range");
+        size_t position = first - begin();
+        const size_t count = static_cast<size_t>(last - first);
+        detail::EraseRangeAt(data_.GetAddress(), size_, position, count);
+        size_ -= count;
+        generation_.Bump();
+        ReleaseUnusedCapacity();
         return begin() + position;
     }
+
+    // Removes every element matching `pred` in a single pass, keeping the
+    // order of the rest, and returns how many were removed.
+    template<typename Pred>
+    ADVANCED_VECTOR_CONSTEXPR size_t EraseIf(Pred pred) {
+        const size_t old_size = size_;
+        detail::RemoveIf(data_.GetAddress(), size_, pred);
+        generation_.Bump();
+        ReleaseUnusedCapacity();
+        return old_size - size_;
+    }
     
-    void Swap(Vector& other) noexcept {
+    // Hands the buffer and its elements over to the caller and leaves the
+    // vector empty. The deleter knows the size, capacity and allocator.
+    [[nodiscard]] BufferPtr<T, Allocator> Release() noexcept {
+        ReleaseStorage();
+        BufferDeleter<T, Allocator> deleter(data_.GetAllocator(), size_, data_.Capacity());
+        size_ = 0;
+        generation_.Bump();
+        return BufferPtr<T, Allocator>(data_.Release(), std::move(deleter));
+    }
+
+    ADVANCED_VECTOR_CONSTEXPR void Swap(Vector& other) noexcept {
+        const size_t capacity = data_.Capacity();
+        const size_t other_capacity = other.data_.Capacity();
         this->data_.Swap(other.data_);
         this->size_ = std::exchange(other.size_, this->size_);
+        TransferStorage(capacity);
+        other.TransferStorage(other_capacity);
+        generation_.Bump();
+        other.generation_.Bump();
     }
 
-    const T& operator[](const size_t index) const noexcept {
+    ADVANCED_VECTOR_CONSTEXPR const T& operator[](const size_t index) const noexcept {
         return const_cast<Vector&>(*this)[index];
     }
 
-    T& operator[](const size_t index) noexcept {
-        assert(index < size_);
+    ADVANCED_VECTOR_CONSTEXPR T& operator[](const size_t index) noexcept {
+        ADVANCED_VECTOR_CHECK(index < size_, "index out of range");
         return data_[index];
     }
 
-    Vector& operator=(const Vector& other) {
+    ADVANCED_VECTOR_CONSTEXPR Vector& operator=(const Vector& other) {
         if(this != &other) {
-            if(this->data_.Capacity() < other.size_) {
-                Vector temp(other);
-                Swap(temp);
-            } else {
-                if(this->size_ < other.size_) {
-                    std::copy(other.data_.GetAddress(), other.data_.GetAddress() + this->size_, this->data_.GetAddress());
-                    std::uninitialized_copy_n(other.data_.GetAddress() + size_, other.size_ - size_, this->data_.GetAddress() + size_);
-                } else {
-                    std::copy(other.data_.GetAddress(), other.data_.GetAddress() + other.size_, this->data_.GetAddress());
-                    std::destroy_n(this->data_.GetAddress() + other.size_, size_ - other.size_);
+            if constexpr (AllocTraits::propagate_on_container_copy_assignment::value) {
+                if(data_.GetAllocator() != other.data_.GetAllocator()) {
+                    std::destroy_n(data_.GetAddress(), size_);
+                    ReleaseStorage();
+                    size_ = 0;
                 }
-                this->size_ = other.size_;
+                data_.CopyAllocator(other.data_.GetAllocator());
             }
+            AssignN(other.data_.GetAddress(), other.size_);
         }
         return *this;
     }
 
-    Vector& operator=(Vector&& other) noexcept {
+    ADVANCED_VECTOR_CONSTEXPR Vector& operator=(Vector&& other) noexcept(AllocTraits::propagate_on_container_move_assignment::value
+                                               || AllocTraits::is_always_equal::value) {
         if(this != &other) {
-            this->data_ = std::move(other.data_);
-            this->size_ = std::exchange(other.size_, 0);
+            if constexpr (AllocTraits::propagate_on_container_move_assignment::value
+                          || AllocTraits::is_always_equal::value) {
+                MoveStorageFrom(other);
+            } else if(data_.GetAllocator() == other.data_.GetAllocator()) {
+                MoveStorageFrom(other);
+            } else {
+                AssignN(std::make_move_iterator(other.begin()), other.size_);
+            }
         }
         return *this;
     }
 
 private:
-    RawMemory<T> data_;
+    RawMemory<T, Allocator> data_;
     size_t size_ = 0;
+    ADVANCED_VECTOR_NO_UNIQUE_ADDRESS Instrumentation instrumentation_;
+    ADVANCED_VECTOR_NO_UNIQUE_ADDRESS detail::hardening::Generation generation_;
 
-    static void CopyConstruct(T* buf, const T& elem) {
-        new (buf) T(elem);
+    ADVANCED_VECTOR_CONSTEXPR iterator MakeIterator(const size_t position) noexcept {
+        return generation_.MakeIterator(data_ + position, data_.GetAddress(), data_ + size_);
     }
 
-    static void Destroy(T* buf) noexcept {
-        buf->~T();
+    ADVANCED_VECTOR_CONSTEXPR const_iterator MakeIterator(const size_t position) const noexcept {
+        const T* const first = data_.GetAddress();
+        return generation_.MakeIterator(first + position, first, first + size_);
     }
 
-    static void DestroyN(T* buf, const size_t count) noexcept {
-        for(size_t i = 0; i != count; ++i) {
-            Destroy(buf + i);
+    // Every change of buffer goes through here so Instrumentation sees it.
+    ADVANCED_VECTOR_CONSTEXPR void SwapStorage(RawMemory<T, Allocator>& new_data, const size_t relocated) noexcept {
+        ReleaseStorage();
+        if(data_.Capacity() != 0 || new_data.Capacity() != 0) {
+            instrumentation_.OnReallocate(data_.Capacity(), new_data.Capacity(), relocated, sizeof(T));
+        }
+        data_.Swap(new_data);
+        generation_.Bump();
+    }
+
+    // Reports the buffer a constructor started out with, if it has one.
+    ADVANCED_VECTOR_CONSTEXPR void ReportInitialStorage() noexcept {
+        if(data_.Capacity() != 0) {
+            instrumentation_.OnReallocate(0, data_.Capacity(), 0, sizeof(T));
+        }
+    }
+
+    ADVANCED_VECTOR_CONSTEXPR void ReleaseStorage() noexcept {
+        if(data_.Capacity() != 0) {
+            instrumentation_.OnRelease(size_, data_.Capacity(), sizeof(T));
+        }
+    }
+
+    // Reports a buffer exchange with another vector; `old_capacity` is the
+    // capacity held before it.
+    ADVANCED_VECTOR_CONSTEXPR void TransferStorage(const size_t old_capacity) noexcept {
+        if(old_capacity != 0 || data_.Capacity() != 0) {
+            instrumentation_.OnTransfer(old_capacity, data_.Capacity(), sizeof(T));
         }
     }
 
-    static void CopyOrMove(T* from, T* to, const size_t count) {
-        if constexpr (std::is_nothrow_move_constructible_v<T> || !std::is_copy_constructible_v<T>) {
-            std::uninitialized_move_n(from, count, to);
+    template<typename InputIt>
+    ADVANCED_VECTOR_CONSTEXPR void AssignN(InputIt first, const size_t count) {
+        generation_.Bump();
+        if(data_.Capacity() < count) {
+            RawMemory<T, Allocator> new_data(count, data_.GetAllocator());
+            detail::UninitializedCopyN(first, count, new_data.GetAddress());
+            std::destroy_n(data_.GetAddress(), size_);
+            SwapStorage(new_data, 0);
+            size_ = count;
+        } else if(size_ < count) {
+            std::copy_n(first, size_, data_.GetAddress());
+            detail::UninitializedCopyN(std::next(first, size_), count - size_, data_.GetAddress() + size_);
+            size_ = count;
         } else {
-            std::uninitialized_copy_n(from, count, to);
+            std::copy_n(first, count, data_.GetAddress());
+            std::destroy_n(data_.GetAddress() + count, size_ - count);
+            size_ = count;
         }
     }
 
-    template<typename... Args>
-    void EmplaceWithAllocate(const size_t position, Args&&... args) {
-        if(size_ == 0) {
-            RawMemory<T> temp(size_ + 1);
-            new (temp.GetAddress()) T(std::forward<Args>(args)...);
-            data_.Swap(temp);
+    ADVANCED_VECTOR_CONSTEXPR size_t GrowCapacity(const size_t required) const noexcept {
+        return std::max(required, GrowthPolicy::NextCapacity(data_.Capacity(), required, sizeof(T)));
+    }
+
+    ADVANCED_VECTOR_CONSTEXPR void ReallocateTo(const size_t new_capacity) {
+        RawMemory<T, Allocator> new_data(new_capacity, data_.GetAllocator());
+
+        detail::RelocateN(data_.GetAddress(), size_, new_data.GetAddress());
+
+        SwapStorage(new_data, size_);
+    }
+
+    bool TryReallocateTo(const size_t new_capacity) {
+        RawMemory<T, Allocator> new_data(data_.GetAllocator());
+        if(!new_data.TryAllocate(new_capacity)) {
+            return false;
+        }
+        detail::RelocateN(data_.GetAddress(), size_, new_data.GetAddress());
+        SwapStorage(new_data, size_);
+        return true;
+    }
+
+    // Lets a GrowthPolicy with ShrinkCapacity give back memory after the
+    // vector got smaller. Shrinking is best effort: if the smaller buffer
+    // cannot be obtained the current one is kept.
+    ADVANCED_VECTOR_CONSTEXPR void ReleaseUnusedCapacity() noexcept {
+        if constexpr (detail::HasShrinkCapacity<GrowthPolicy>::value) {
+            const size_t new_capacity = GrowthPolicy::ShrinkCapacity(size_, data_.Capacity(), sizeof(T));
+            if(new_capacity < data_.Capacity()) {
+                ADVANCED_VECTOR_TRY {
+                    TryReallocateTo(std::max(new_capacity, size_));
+                } ADVANCED_VECTOR_CATCH_ALL {
+                }
+            }
+        }
+    }
+
+    template<typename ForwardIt>
+    ADVANCED_VECTOR_CONSTEXPR iterator InsertRange(const size_t position, ForwardIt first, const size_t count) {
+        if(size_ + count <= data_.Capacity()) {
+            detail::InsertRangeInSpare(data_.GetAddress(), size_, position, first, count);
+            if(position != size_) {
+                generation_.Bump();
+            }
         } else {
-            RawMemory<T> temp(data_.Capacity() * 2);
-            new (temp + position) T(std::forward<Args>(args)...);
-            CopyOrMove(data_.GetAddress(), temp.GetAddress(), position);
-            CopyOrMove(data_ + position, temp + position + 1, size_ - position);
-            data_.Swap(temp);
-            std::destroy_n(temp.GetAddress(), size_);
+            RawMemory<T, Allocator> temp(GrowCapacity(size_ + count), data_.GetAllocator());
+            detail::UninitializedCopyN(first, count, temp + position);
+            detail::RelocateAround(data_.GetAddress(), size_, position, temp.GetAddress(), count);
+            SwapStorage(temp, size_);
+        }
+        size_ += count;
+        return begin() + position;
+    }
+
+    ADVANCED_VECTOR_CONSTEXPR void MoveStorageFrom(Vector& other) noexcept {
+        std::destroy_n(data_.GetAddress(), size_);
+        ReleaseStorage();
+        const size_t capacity = other.data_.Capacity();
+        data_ = std::move(other.data_);
+        size_ = std::exchange(other.size_, 0);
+        TransferStorage(0);
+        other.TransferStorage(capacity);
+        generation_.Bump();
+        other.generation_.Bump();
+    }
+
+    ADVANCED_VECTOR_CONSTEXPR static void CopyConstruct(T* buf, const T& elem) {
+        detail::ConstructAt(buf, elem);
+    }
+
+    ADVANCED_VECTOR_CONSTEXPR static void Destroy(T* buf) noexcept {
+        buf->~T();
+    }
+
+    ADVANCED_VECTOR_CONSTEXPR static void DestroyN(T* buf, const size_t count) noexcept {
+        for(size_t i = 0; i != count; ++i) {
+            Destroy(buf + i);
         }
     }
 
     template<typename... Args>
-    void EmplaceWithoutAllocate(const size_t position, Args&&... args) {
-        if(position < size_) {
-            try {
-                T new_elem = T(std::forward<Args>(args)...);
-                new (data_ + size_) T(std::forward<T>(data_[size_ - 1]));
-                std::move_backward(data_ + position, end() - 1, end());
-                *(begin() + position) = std::forward<T>(new_elem);
-            } catch (...) {
-                operator delete (end());
-                throw;
+    ADVANCED_VECTOR_CONSTEXPR void EmplaceWithAllocate(const size_t position, Args&&... args) {
+        if constexpr (IsTriviallyRelocatableV<T> && RawMemory<T, Allocator>::CanExpand()) {
+            if(size_ != 0) {
+                alignas(T) unsigned char storage[sizeof(T)];
+                T* new_elem = new (storage) T(std::forward<Args>(args)...);
+                ADVANCED_VECTOR_TRY {
+                    Reserve(GrowCapacity(size_ + 1));
+                } ADVANCED_VECTOR_CATCH_ALL {
+                    std::destroy_at(new_elem);
+                    ADVANCED_VECTOR_RETHROW;
+                }
+                detail::MemMoveN(data_ + position + 1, data_ + position, size_ - position);
+                detail::MemMoveN(data_ + position, new_elem, 1);
+                return;
             }
+        }
+        if(size_ == 0) {
+            RawMemory<T, Allocator> temp(GrowCapacity(size_ + 1), data_.GetAllocator());
+            detail::ConstructAt(temp.GetAddress(), std::forward<Args>(args)...);
+            SwapStorage(temp, 0);
+        } else {
+            RawMemory<T, Allocator> temp(GrowCapacity(size_ + 1), data_.GetAllocator());
+            detail::ConstructAt(temp + position, std::forward<Args>(args)...);
+            detail::RelocateAround(data_.GetAddress(), size_, position, temp.GetAddress());
+            SwapStorage(temp, size_);
+        }
+    }
+};
+
+template<typename T, typename Allocator, typename GrowthPolicy, typename Instrumentation>
+ADVANCED_VECTOR_CONSTEXPR bool operator==(const Vector<T, Allocator, GrowthPolicy, Instrumentation>& lhs,
+                                          const Vector<T, Allocator, GrowthPolicy, Instrumentation>& rhs) {
+    if(detail::IsConstantEvaluated()) {
+        return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+    }
+    return lhs.Size() == rhs.Size() && detail::simd::Mismatch(lhs.Data(), rhs.Data(), lhs.Size()) == lhs.Size();
+}
+
+template<typename T, typename Allocator, typename GrowthPolicy, typename Instrumentation>
+ADVANCED_VECTOR_CONSTEXPR bool operator!=(const Vector<T, Allocator, GrowthPolicy, Instrumentation>& lhs,
+                                          const Vector<T, Allocator, GrowthPolicy, Instrumentation>& rhs) {
+    return !(lhs == rhs);
+}
+
+// Lexicographical. Integers find the first difference with the vectorized
+// kernel; other types, floating point included, compare element by element.
+template<typename T, typename Allocator, typename GrowthPolicy, typename Instrumentation>
+ADVANCED_VECTOR_CONSTEXPR bool operator<(const Vector<T, Allocator, GrowthPolicy, Instrumentation>& lhs,
+                                         const Vector<T, Allocator, GrowthPolicy, Instrumentation>& rhs) {
+    if constexpr (std::is_integral_v<T>) {
+        if(!detail::IsConstantEvaluated()) {
+            const size_t common = std::min(lhs.Size(), rhs.Size());
+            const size_t pos = detail::simd::Mismatch(lhs.Data(), rhs.Data(), common);
+            return pos == common ? lhs.Size() < rhs.Size() : lhs[pos] < rhs[pos];
+        }
+    }
+    return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+}
+
+template<typename T, typename Allocator, typename GrowthPolicy, typename Instrumentation>
+ADVANCED_VECTOR_CONSTEXPR bool operator>(const Vector<T, Allocator, GrowthPolicy, Instrumentation>& lhs,
+                                         const Vector<T, Allocator, GrowthPolicy, Instrumentation>& rhs) {
+    return rhs < lhs;
+}
+
+template<typename T, typename Allocator, typename GrowthPolicy, typename Instrumentation>
+ADVANCED_VECTOR_CONSTEXPR bool operator<=(const Vector<T, Allocator, GrowthPolicy, Instrumentation>& lhs,
+                                          const Vector<T, Allocator, GrowthPolicy, Instrumentation>& rhs) {
+    return !(rhs < lhs);
+}
+
+template<typename T, typename Allocator, typename GrowthPolicy, typename Instrumentation>
+ADVANCED_VECTOR_CONSTEXPR bool operator>=(const Vector<T, Allocator, GrowthPolicy, Instrumentation>& lhs,
+                                          const Vector<T, Allocator, GrowthPolicy, Instrumentation>& rhs) {
+    return !(lhs < rhs);
+}
+
+// Concatenates vectors of one type, sizing the result up front. Rvalue
+// arguments are relocated and left empty, lvalues are copied, and an rvalue
+// first argument lends the result its buffer.
+template<typename Vec, typename... Vecs>
+ADVANCED_VECTOR_CONSTEXPR std::decay_t<Vec> Concat(Vec&& first, Vecs&&... rest) {
+    using Result = std::decay_t<Vec>;
+    static_assert((std::is_same_v<Result, std::decay_t<Vecs>> && ...), "Concat takes vectors of one type");
+    const size_t total = first.Size() + (size_t{0} + ... + rest.Size());
+    if constexpr (std::is_lvalue_reference_v<Vec>) {
+        using AllocTraits = std::allocator_traits<typename Result::allocator_type>;
+        Result result(AllocTraits::select_on_container_copy_construction(first.GetAllocator()));
+        result.Reserve(total);
+        result.Append(first);
+        (result.Append(std::forward<Vecs>(rest)), ...);
+        return result;
+    } else {
+        Result result(std::move(first));
+        result.Reserve(total);
+        (result.Append(std::forward<Vecs>(rest)), ...);
+        return result;
+    }
+}
+
+// Concat for a range of vectors, e.g. partial results collected at run time.
+// The vectors are relocated when the range is an rvalue.
+template<typename Range>
+ADVANCED_VECTOR_CONSTEXPR auto ConcatAll(Range&& parts) {
+    using std::begin;
+    std::decay_t<decltype(*begin(parts))> result;
+    size_t total = 0;
+    for(const auto& part : parts) {
+        total += part.Size();
+    }
+    result.Reserve(total);
+    for(auto& part : parts) {
+        if constexpr (std::is_lvalue_reference_v<Range>) {
+            result.Append(part);
         } else {
-            new (data_ + size_) T(std::forward<Args>(args)...);
+            result.Append(std::move(part));
         }
     }
-};
\ No newline at end of file
+    return result;
+}
+
+#ifdef ADVANCED_VECTOR_HAS_CONSTEXPR
+// Memory allocated during constant evaluation must be freed before it ends,
+// so a Vector cannot be a constexpr variable itself. ToArray copies its
+// elements into a std::array that can:
+//   constexpr auto TABLE = ToArray<256>(MakeTable());
+template<size_t N, typename T, typename Allocator, typename GrowthPolicy, typename Instrumentation>
+constexpr std::array<T, N> ToArray(const Vector<T, Allocator, GrowthPolicy, Instrumentation>& v) {
+    if(v.Size() != N) {
+        ADVANCED_VECTOR_THROW(std::length_error("ToArray: size mismatch"));
+    }
+    std::array<T, N> result{};
+    std::copy_n(v.begin(), N, result.begin());
+    return result;
+}
+
+// Same, with N taken from the vector `Generator` returns:
+//   constexpr auto TABLE = ToArray<[] { return MakeTable(); }>();
+template<auto Generator>
+constexpr auto ToArray() {
+    constexpr size_t size = Generator().Size();
+    return ToArray<size>(Generator());
+}
+#endif
+
+template<typename T, size_t Alignment = CACHE_LINE_SIZE, typename GrowthPolicy = DoublingGrowthPolicy>
+using AlignedVector = Vector<T, AlignedAllocator<T, Alignment>, GrowthPolicy>;
+
+// AlignedVector whose buffers never share a cache line with other allocations.
+template<typename T, size_t Alignment = CACHE_LINE_SIZE, typename GrowthPolicy = DoublingGrowthPolicy>
+using PaddedVector = Vector<T, AlignedAllocator<T, Alignment, true>, GrowthPolicy>;
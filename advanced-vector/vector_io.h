@@ -0,0 +1,343 @@
+#pragma once
+
+#include "vector.h"
+
+#if !defined(__unix__) && !(defined(__APPLE__) && defined(__MACH__))
+#error "vector_io.h relies on POSIX read/writev"
+#endif
+
+#include <cerrno>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// Binary format: a SerializedHeader followed either by the raw bytes of the
+// elements (trivially copyable T) or by one Codec<T>::Encode record per
+// element. Snapshots are only read back on machines with the same byte order.
+
+namespace detail {
+
+struct SerializedHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint8_t little_endian;
+    uint8_t format;
+    uint32_t elem_size;
+    uint32_t reserved;
+    uint64_t count;
+};
+
+static_assert(sizeof(SerializedHeader) == 24, "SerializedHeader is part of the file format");
+
+inline constexpr uint32_t SERIALIZED_MAGIC = 0x31414456;  // "VDA1"
+inline constexpr uint16_t SERIALIZED_VERSION = 1;
+inline constexpr uint8_t FORMAT_RAW = 0;
+inline constexpr uint8_t FORMAT_CODEC = 1;
+inline constexpr size_t IO_BUFFER_SIZE = size_t{64} << 10;
+
+inline bool IsLittleEndian() noexcept {
+    const uint16_t probe = 1;
+    unsigned char first_byte = 0;
+    std::memcpy(&first_byte, &probe, 1);
+    return first_byte == 1;
+}
+
+template<typename T>
+SerializedHeader MakeHeader(const size_t count) noexcept {
+    return SerializedHeader{SERIALIZED_MAGIC, SERIALIZED_VERSION, static_cast<uint8_t>(IsLittleEndian()),
+                            std::is_trivially_copyable_v<T> ? FORMAT_RAW : FORMAT_CODEC,
+                            static_cast<uint32_t>(sizeof(T)), 0, count};
+}
+
+// Writes every iovec, resuming after partial writes.
+inline void WriteAll(const int fd, iovec* iov, int count) {
+    while(count > 0) {
+        const ssize_t written = ::writev(fd, iov, count);
+        if(written < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            ADVANCED_VECTOR_THROW(std::system_error(errno, std::generic_category(), "writev"));
+        }
+        size_t left = static_cast<size_t>(written);
+        while(count > 0 && left >= iov->iov_len) {
+            left -= iov->iov_len;
+            ++iov;
+            --count;
+        }
+        if(count > 0) {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + left;
+            iov->iov_len -= left;
+        }
+    }
+}
+
+// Reads until `bytes` are read or the input ends; returns the bytes read.
+inline size_t ReadAll(const int fd, void* data, const size_t bytes) {
+    size_t done = 0;
+    while(done != bytes) {
+        const ssize_t got = ::read(fd, static_cast<char*>(data) + done, bytes - done);
+        if(got < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            ADVANCED_VECTOR_THROW(std::system_error(errno, std::generic_category(), "read"));
+        }
+        if(got == 0) {
+            break;
+        }
+        done += static_cast<size_t>(got);
+    }
+    return done;
+}
+
+}  // namespace detail
+
+// Buffered output for codecs.
+class ByteWriter {
+public:
+    explicit ByteWriter(const int fd)
+    : fd_(fd)
+    , buffer_(std::make_unique<char[]>(detail::IO_BUFFER_SIZE)) {
+    }
+
+    void Write(const void* data, const size_t bytes) {
+        if(used_ + bytes > detail::IO_BUFFER_SIZE) {
+            Flush();
+        }
+        if(bytes >= detail::IO_BUFFER_SIZE) {
+            iovec iov{const_cast<void*>(data), bytes};
+            detail::WriteAll(fd_, &iov, 1);
+            return;
+        }
+        std::memcpy(buffer_.get() + used_, data, bytes);
+        used_ += bytes;
+    }
+
+    template<typename U>
+    void WriteValue(const U& value) {
+        static_assert(std::is_trivially_copyable_v<U>, "WriteValue copies the bytes of U");
+        Write(&value, sizeof(U));
+    }
+
+    void Flush() {
+        if(used_ != 0) {
+            iovec iov{buffer_.get(), used_};
+            detail::WriteAll(fd_, &iov, 1);
+            used_ = 0;
+        }
+    }
+
+private:
+    int fd_;
+    std::unique_ptr<char[]> buffer_;
+    size_t used_ = 0;
+};
+
+// Buffered input for codecs and for the header. Large reads go straight into
+// the destination once the buffer is drained.
+class ByteReader {
+public:
+    explicit ByteReader(const int fd)
+    : fd_(fd)
+    , buffer_(std::make_unique<char[]>(detail::IO_BUFFER_SIZE)) {
+    }
+
+    // Throws std::runtime_error if the input ends first.
+    void Read(void* data, size_t bytes) {
+        char* out = static_cast<char*>(data);
+        const size_t buffered = std::min(bytes, end_ - pos_);
+        std::memcpy(out, buffer_.get() + pos_, buffered);
+        pos_ += buffered;
+        out += buffered;
+        bytes -= buffered;
+        if(bytes == 0) {
+            return;
+        }
+        if(bytes >= detail::IO_BUFFER_SIZE) {
+            if(detail::ReadAll(fd_, out, bytes) != bytes) {
+                ADVANCED_VECTOR_THROW(std::runtime_error("ByteReader: unexpected end of data"));
+            }
+            return;
+        }
+        end_ = detail::ReadAll(fd_, buffer_.get(), detail::IO_BUFFER_SIZE);
+        pos_ = 0;
+        if(end_ < bytes) {
+            ADVANCED_VECTOR_THROW(std::runtime_error("ByteReader: unexpected end of data"));
+        }
+        std::memcpy(out, buffer_.get(), bytes);
+        pos_ = bytes;
+    }
+
+    // Bytes known to be left in the input: the rest of a regular file, and
+    // only what is buffered for pipes and sockets.
+    [[nodiscard]] size_t BytesLeft() const noexcept {
+        const size_t buffered = end_ - pos_;
+        struct stat info;
+        if(fstat(fd_, &info) != 0 || !S_ISREG(info.st_mode)) {
+            return buffered;
+        }
+        const off_t offset = lseek(fd_, 0, SEEK_CUR);
+        if(offset < 0 || offset > info.st_size) {
+            return buffered;
+        }
+        const auto unread = static_cast<uint64_t>(info.st_size - offset);
+        return static_cast<size_t>(std::min<uint64_t>(unread, SIZE_MAX - buffered)) + buffered;
+    }
+
+    template<typename U>
+    U ReadValue() {
+        static_assert(std::is_trivially_copyable_v<U> && std::is_trivially_default_constructible_v<U>,
+                      "ReadValue fills the bytes of U");
+        U value;
+        Read(&value, sizeof(U));
+        return value;
+    }
+
+private:
+    int fd_;
+    std::unique_ptr<char[]> buffer_;
+    size_t pos_ = 0;
+    size_t end_ = 0;
+};
+
+// Element encoding for types that are not trivially copyable. Specialize it
+// with
+//   static void Encode(const T& value, ByteWriter& out);
+//   static T Decode(ByteReader& in);
+template<typename T, typename = void>
+struct Codec;
+
+template<>
+struct Codec<std::string> {
+    static void Encode(const std::string& value, ByteWriter& out) {
+        out.WriteValue(static_cast<uint64_t>(value.size()));
+        out.Write(value.data(), value.size());
+    }
+
+    static std::string Decode(ByteReader& in) {
+        std::string value(static_cast<size_t>(in.ReadValue<uint64_t>()), '\0');
+        in.Read(value.data(), value.size());
+        return value;
+    }
+};
+
+// Writes a header and the elements. Trivially copyable elements are written
+// together with the header by a single writev, straight from the buffer.
+template<typename T, typename Allocator, typename GrowthPolicy, typename Instrumentation>
+void WriteVector(const int fd, const Vector<T, Allocator, GrowthPolicy, Instrumentation>& v) {
+    detail::SerializedHeader header = detail::MakeHeader<T>(v.Size());
+    if constexpr (std::is_trivially_copyable_v<T>) {
+        iovec iov[2] = {
+            {&header, sizeof(header)},
+            {const_cast<T*>(v.Data()), v.Size() * sizeof(T)},
+        };
+        detail::WriteAll(fd, iov, 2);
+    } else {
+        ByteWriter out(fd);
+        out.WriteValue(header);
+        for(const T& elem : v) {
+            Codec<T>::Encode(elem, out);
+        }
+        out.Flush();
+    }
+}
+
+// Streams the elements written by WriteVector into vectors, chunk by chunk.
+// Trivially copyable elements are read directly into the spare capacity of
+// the vector instead of being value-initialized and then overwritten.
+template<typename T>
+class VectorReader {
+public:
+    static constexpr size_t DEFAULT_CHUNK = std::max<size_t>(detail::IO_BUFFER_SIZE / sizeof(T), 1);
+
+    // Reads and checks the header; throws std::runtime_error if it does not
+    // describe a vector of T written on a machine with the same byte order.
+    explicit VectorReader(const int fd)
+    : in_(fd) {
+        const auto header = in_.ReadValue<detail::SerializedHeader>();
+        const detail::SerializedHeader expected = detail::MakeHeader<T>(0);
+        if(header.magic != expected.magic || header.version != expected.version) {
+            ADVANCED_VECTOR_THROW(std::runtime_error("VectorReader: not a serialized vector"));
+        }
+        if(header.little_endian != expected.little_endian) {
+            ADVANCED_VECTOR_THROW(std::runtime_error("VectorReader: byte order mismatch"));
+        }
+        if(header.format != expected.format || header.elem_size != expected.elem_size) {
+            ADVANCED_VECTOR_THROW(std::runtime_error("VectorReader: element type mismatch"));
+        }
+        remaining_ = static_cast<size_t>(header.count);
+    }
+
+    // Elements not read yet.
+    [[nodiscard]] size_t Remaining() const noexcept {
+        return remaining_;
+    }
+
+    // Appends up to `max_count` elements to `v` and returns how many. Reserve
+    // the vector up front to avoid a reallocation per chunk.
+    template<typename Allocator, typename GrowthPolicy, typename Instrumentation>
+    size_t ReadChunk(Vector<T, Allocator, GrowthPolicy, Instrumentation>& v, const size_t max_count = DEFAULT_CHUNK) {
+        const size_t count = std::min(max_count, remaining_);
+        const size_t old_size = v.Size();
+        if constexpr (std::is_trivially_copyable_v<T> && std::is_trivially_default_constructible_v<T>) {
+            v.ResizeForOverwrite(old_size + count, [this, old_size, count](T* data, size_t) {
+                in_.Read(data + old_size, count * sizeof(T));
+                return old_size + count;
+            });
+        } else if constexpr (std::is_trivially_copyable_v<T>) {
+            v.Reserve(old_size + count);
+            for(size_t i = 0; i != count; ++i) {
+                alignas(T) unsigned char bytes[sizeof(T)];
+                in_.Read(bytes, sizeof(T));
+                v.EmplaceBack(*std::launder(reinterpret_cast<T*>(bytes)));
+            }
+        } else {
+            v.Reserve(old_size + count);
+            for(size_t i = 0; i != count; ++i) {
+                v.EmplaceBack(Codec<T>::Decode(in_));
+            }
+        }
+        remaining_ -= count;
+        return count;
+    }
+
+    // Appends the remaining elements to `v`; if reading fails, the elements
+    // appended so far are removed again. The count in the header is not
+    // trusted with an allocation of its own: the up-front reserve is capped
+    // by the bytes left in the input, and past that the vector grows with
+    // the data actually read.
+    template<typename Allocator, typename GrowthPolicy, typename Instrumentation>
+    void ReadAll(Vector<T, Allocator, GrowthPolicy, Instrumentation>& v) {
+        constexpr size_t MIN_ENCODED_SIZE = std::is_trivially_copyable_v<T> ? sizeof(T) : 1;
+        const size_t old_size = v.Size();
+        ADVANCED_VECTOR_TRY {
+            v.Reserve(old_size + std::min(remaining_, in_.BytesLeft() / MIN_ENCODED_SIZE));
+            while(remaining_ != 0) {
+                if(v.Size() == v.Capacity()) {
+                    v.Reserve(v.Size() + std::min(remaining_, std::max(v.Size(), DEFAULT_CHUNK)));
+                }
+                ReadChunk(v, std::min(DEFAULT_CHUNK, v.Capacity() - v.Size()));
+            }
+        } ADVANCED_VECTOR_CATCH_ALL {
+            v.EraseRange(v.cbegin() + old_size, v.cend());
+            ADVANCED_VECTOR_RETHROW;
+        }
+    }
+
+private:
+    ByteReader in_;
+    size_t remaining_ = 0;
+};
+
+template<typename T, typename Allocator = std::allocator<T>>
+Vector<T, Allocator> ReadVector(const int fd, const Allocator& alloc = Allocator()) {
+    VectorReader<T> reader(fd);
+    Vector<T, Allocator> v(alloc);
+    reader.ReadAll(v);
+    return v;
+}
@@ -0,0 +1,406 @@
+#pragma once
+
+#include "vector.h"
+
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <tuple>
+
+#if __cplusplus >= 202002L && __has_include(<source_location>)
+#include <source_location>
+#endif
+
+// Opt-in heap profile of Vector buffers, grouped by the code that created
+// the vectors. Vectors take part by using ProfilingInstrumentation, usually
+// through ProfiledVector, and name their call site with ProfileHere():
+//   ProfiledVector<Route> routes(ProfileHere());
+// Nothing is recorded until VectorProfiler::Enable is called, and then only
+// one vector in `sample_period` per thread is tracked. Vectors constructed
+// otherwise, e.g. copies, are reported under an unnamed site.
+//
+// Instrumentation only sees buffers, not the size of a vector between
+// reallocations, so wasted capacity is measured when a buffer is released:
+// on reallocation, destruction or Release().
+
+struct SourceSite {
+    const char* file = "";
+    const char* function = "";
+    uint32_t line = 0;
+
+#if defined(__cpp_lib_source_location)
+    static constexpr SourceSite Current(const std::source_location location = std::source_location::current()) noexcept {
+        return {location.file_name(), location.function_name(), location.line()};
+    }
+#elif defined(__GNUC__) || defined(__clang__)
+    static constexpr SourceSite Current(const char* file = __builtin_FILE(), const char* function = __builtin_FUNCTION(),
+                                        const uint32_t line = __builtin_LINE()) noexcept {
+        return {file, function, line};
+    }
+#else
+    static constexpr SourceSite Current() noexcept {
+        return {};
+    }
+#endif
+};
+
+inline constexpr size_t REALLOCATION_BUCKETS = 8;
+
+struct VectorSiteReport {
+    SourceSite site;
+    // Tracked vectors created at the site, and those still alive.
+    size_t vectors = 0;
+    size_t live_vectors = 0;
+    // Capacity currently held and ever obtained, in bytes.
+    size_t live_bytes = 0;
+    size_t allocated_bytes = 0;
+    // Buffers replaced by a larger one.
+    size_t reallocations = 0;
+    size_t released_buffers = 0;
+    // (capacity - size) * sizeof(T) summed over released buffers.
+    size_t wasted_bytes = 0;
+    // Tracked vectors destroyed after 0, 1, 2-3, 4-7, ... reallocations.
+    size_t reallocation_histogram[REALLOCATION_BUCKETS] = {};
+};
+
+namespace detail::profiling {
+
+struct SiteStats {
+    explicit SiteStats(const SourceSite& site) noexcept
+    : site(site) {
+    }
+
+    SourceSite site;
+    std::atomic<size_t> vectors{0};
+    std::atomic<size_t> live_vectors{0};
+    std::atomic<size_t> live_bytes{0};
+    std::atomic<size_t> allocated_bytes{0};
+    std::atomic<size_t> reallocations{0};
+    std::atomic<size_t> released_buffers{0};
+    std::atomic<size_t> wasted_bytes{0};
+    std::atomic<size_t> reallocation_histogram[REALLOCATION_BUCKETS] = {};
+};
+
+// Sites are never removed, so tracked vectors keep plain pointers to them.
+// The registry is leaked on purpose: vectors with static storage duration
+// may outlive any static destructor.
+struct Registry {
+    std::mutex mutex;
+    std::map<std::tuple<std::string_view, uint32_t, std::string_view>, SiteStats> sites;
+
+    static Registry& Get() {
+        static Registry* registry = new Registry;
+        return *registry;
+    }
+
+    SiteStats& Find(const SourceSite& site) {
+        const std::lock_guard lock(mutex);
+        return sites.try_emplace(std::make_tuple(std::string_view(site.file), site.line, std::string_view(site.function)),
+                                 site).first->second;
+    }
+};
+
+inline std::atomic<uint32_t> sample_period{0};
+
+// True for one call in `sample_period` on each thread; never while disabled.
+inline bool Sample() noexcept {
+    const uint32_t period = sample_period.load(std::memory_order_relaxed);
+    if(period == 0) {
+        return false;
+    }
+    static thread_local uint32_t countdown = 0;
+    if(countdown != 0) {
+        --countdown;
+        return false;
+    }
+    countdown = period - 1;
+    return true;
+}
+
+inline size_t HistogramBucket(const size_t reallocations) noexcept {
+    return reallocations == 0 ? 0 : std::min(FloorLog2(reallocations) + 1, REALLOCATION_BUCKETS - 1);
+}
+
+inline void Add(std::atomic<size_t>& counter, const size_t value) noexcept {
+    counter.fetch_add(value, std::memory_order_relaxed);
+}
+
+inline void Subtract(std::atomic<size_t>& counter, const size_t value) noexcept {
+    counter.fetch_sub(value, std::memory_order_relaxed);
+}
+
+// Encoder for the subset of protobuf that profile.proto needs.
+class ProtoWriter {
+public:
+    void Varint(uint64_t value) {
+        while(value >= 0x80) {
+            out_.push_back(static_cast<char>(value | 0x80));
+            value >>= 7;
+        }
+        out_.push_back(static_cast<char>(value));
+    }
+
+    void Uint(const uint32_t field, const uint64_t value) {
+        Varint(uint64_t{field} << 3);
+        Varint(value);
+    }
+
+    void Bytes(const uint32_t field, const std::string_view bytes) {
+        Varint(uint64_t{field} << 3 | 2);
+        Varint(bytes.size());
+        out_.append(bytes.data(), bytes.size());
+    }
+
+    [[nodiscard]] const std::string& Str() const noexcept {
+        return out_;
+    }
+
+private:
+    std::string out_;
+};
+
+inline void WriteJsonString(std::ostream& out, const std::string_view text) {
+    out << '"';
+    for(const char c : text) {
+        if(c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if(static_cast<unsigned char>(c) < 0x20) {
+            static constexpr char HEX[] = "0123456789abcdef";
+            out << "\\u00" << HEX[(c >> 4) & 0xF] << HEX[c & 0xF];
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+}  // namespace detail::profiling
+
+// Instrumentation that feeds VectorProfiler. Move-only: a copied vector
+// starts with a fresh, unnamed instance.
+class ProfilingInstrumentation {
+public:
+    ProfilingInstrumentation() noexcept
+    : ProfilingInstrumentation(SourceSite{}) {
+    }
+
+    explicit ProfilingInstrumentation(const SourceSite& site) noexcept {
+        if(!detail::profiling::Sample()) {
+            return;
+        }
+        ADVANCED_VECTOR_TRY {
+            stats_ = &detail::profiling::Registry::Get().Find(site);
+        } ADVANCED_VECTOR_CATCH_ALL {
+            return;
+        }
+        detail::profiling::Add(stats_->vectors, 1);
+        detail::profiling::Add(stats_->live_vectors, 1);
+    }
+
+    ProfilingInstrumentation(ProfilingInstrumentation&& other) noexcept
+    : stats_(std::exchange(other.stats_, nullptr))
+    , held_bytes_(std::exchange(other.held_bytes_, 0))
+    , reallocations_(std::exchange(other.reallocations_, 0)) {
+    }
+
+    ProfilingInstrumentation& operator=(ProfilingInstrumentation&&) = delete;
+
+    ~ProfilingInstrumentation() {
+        if(stats_ != nullptr) {
+            detail::profiling::Subtract(stats_->live_bytes, held_bytes_);
+            detail::profiling::Subtract(stats_->live_vectors, 1);
+            detail::profiling::Add(stats_->reallocation_histogram[detail::profiling::HistogramBucket(reallocations_)], 1);
+        }
+    }
+
+    [[nodiscard]] bool IsTracked() const noexcept {
+        return stats_ != nullptr;
+    }
+
+    void OnReallocate(const size_t old_capacity, const size_t new_capacity, size_t /*relocated*/,
+                      const size_t elem_size) noexcept {
+        if(stats_ == nullptr) {
+            return;
+        }
+        const size_t new_bytes = new_capacity * elem_size;
+        detail::profiling::Add(stats_->live_bytes, new_bytes);
+        detail::profiling::Subtract(stats_->live_bytes, held_bytes_);
+        detail::profiling::Add(stats_->allocated_bytes, new_bytes);
+        held_bytes_ = new_bytes;
+        if(old_capacity != 0) {
+            ++reallocations_;
+            detail::profiling::Add(stats_->reallocations, 1);
+        }
+    }
+
+    void OnRelease(const size_t size, const size_t capacity, const size_t elem_size) noexcept {
+        if(stats_ == nullptr) {
+            return;
+        }
+        detail::profiling::Subtract(stats_->live_bytes, held_bytes_);
+        held_bytes_ = 0;
+        detail::profiling::Add(stats_->released_buffers, 1);
+        detail::profiling::Add(stats_->wasted_bytes, (capacity - size) * elem_size);
+    }
+
+    // Re-attributes live bytes only: the buffers were neither allocated nor
+    // released.
+    void OnTransfer(size_t /*old_capacity*/, const size_t new_capacity, const size_t elem_size) noexcept {
+        if(stats_ == nullptr) {
+            return;
+        }
+        const size_t new_bytes = new_capacity * elem_size;
+        detail::profiling::Add(stats_->live_bytes, new_bytes);
+        detail::profiling::Subtract(stats_->live_bytes, held_bytes_);
+        held_bytes_ = new_bytes;
+    }
+
+private:
+    detail::profiling::SiteStats* stats_ = nullptr;
+    size_t held_bytes_ = 0;
+    size_t reallocations_ = 0;
+};
+
+// Names the call site of a ProfiledVector.
+inline ProfilingInstrumentation ProfileHere(const SourceSite& site = SourceSite::Current()) noexcept {
+    return ProfilingInstrumentation(site);
+}
+
+template<typename T, typename Allocator = std::allocator<T>, typename GrowthPolicy = DoublingGrowthPolicy>
+using ProfiledVector = Vector<T, Allocator, GrowthPolicy, ProfilingInstrumentation>;
+
+class VectorProfiler {
+public:
+    // Starts tracking one new vector in `sample_period` on each thread.
+    static void Enable(const uint32_t sample_period = 1) noexcept {
+        detail::profiling::sample_period.store(sample_period, std::memory_order_relaxed);
+    }
+
+    // Stops tracking new vectors; those already tracked keep reporting.
+    static void Disable() noexcept {
+        detail::profiling::sample_period.store(0, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] static uint32_t GetSamplePeriod() noexcept {
+        return detail::profiling::sample_period.load(std::memory_order_relaxed);
+    }
+
+    // One entry per site, the largest live_bytes first.
+    [[nodiscard]] static Vector<VectorSiteReport> Report() {
+        detail::profiling::Registry& registry = detail::profiling::Registry::Get();
+        Vector<VectorSiteReport> report;
+        {
+            const std::lock_guard lock(registry.mutex);
+            report.Reserve(registry.sites.size());
+            for(const auto& [key, stats] : registry.sites) {
+                VectorSiteReport& entry = report.EmplaceBack();
+                entry.site = stats.site;
+                entry.vectors = stats.vectors.load(std::memory_order_relaxed);
+                entry.live_vectors = stats.live_vectors.load(std::memory_order_relaxed);
+                entry.live_bytes = stats.live_bytes.load(std::memory_order_relaxed);
+                entry.allocated_bytes = stats.allocated_bytes.load(std::memory_order_relaxed);
+                entry.reallocations = stats.reallocations.load(std::memory_order_relaxed);
+                entry.released_buffers = stats.released_buffers.load(std::memory_order_relaxed);
+                entry.wasted_bytes = stats.wasted_bytes.load(std::memory_order_relaxed);
+                for(size_t i = 0; i != REALLOCATION_BUCKETS; ++i) {
+                    entry.reallocation_histogram[i] = stats.reallocation_histogram[i].load(std::memory_order_relaxed);
+                }
+            }
+        }
+        std::stable_sort(report.begin(), report.end(), [](const VectorSiteReport& lhs, const VectorSiteReport& rhs) {
+            return lhs.live_bytes > rhs.live_bytes;
+        });
+        return report;
+    }
+
+    static void WriteJson(std::ostream& out) {
+        using detail::profiling::WriteJsonString;
+        out << "{\"sample_period\":" << GetSamplePeriod() << ",\"sites\":[";
+        bool first = true;
+        for(const VectorSiteReport& entry : Report()) {
+            out << (first ? "" : ",") << "{\"file\":";
+            first = false;
+            WriteJsonString(out, entry.site.file);
+            out << ",\"line\":" << entry.site.line << ",\"function\":";
+            WriteJsonString(out, entry.site.function);
+            out << ",\"vectors\":" << entry.vectors << ",\"live_vectors\":" << entry.live_vectors
+                << ",\"live_bytes\":" << entry.live_bytes << ",\"allocated_bytes\":" << entry.allocated_bytes
+                << ",\"reallocations\":" << entry.reallocations << ",\"released_buffers\":" << entry.released_buffers
+                << ",\"wasted_bytes\":" << entry.wasted_bytes << ",\"reallocation_histogram\":[";
+            for(size_t i = 0; i != REALLOCATION_BUCKETS; ++i) {
+                out << (i == 0 ? "" : ",") << entry.reallocation_histogram[i];
+            }
+            out << "]}";
+        }
+        out << "]}";
+    }
+
+    // Writes an uncompressed profile.proto message that `pprof` reads
+    // directly, with one sample per site. Values are not scaled by the
+    // sample period.
+    static void WritePprof(std::ostream& out) {
+        using detail::profiling::ProtoWriter;
+        const Vector<VectorSiteReport> report = Report();
+        ProtoWriter profile;
+        Vector<std::string_view> strings;
+        std::map<std::string_view, uint64_t> string_ids;
+        const auto intern = [&strings, &string_ids](const std::string_view text) {
+            const auto [it, inserted] = string_ids.try_emplace(text, strings.Size());
+            if(inserted) {
+                strings.PushBack(text);
+            }
+            return it->second;
+        };
+        intern("");
+
+        static constexpr std::string_view SAMPLE_TYPES[][2] = {
+            {"live_vectors", "count"}, {"live_bytes", "bytes"},   {"allocated_bytes", "bytes"},
+            {"wasted_bytes", "bytes"}, {"reallocations", "count"},
+        };
+        for(const auto& [type, unit] : SAMPLE_TYPES) {
+            ProtoWriter value_type;
+            value_type.Uint(1, intern(type));
+            value_type.Uint(2, intern(unit));
+            profile.Bytes(1, value_type.Str());
+        }
+
+        for(size_t i = 0; i != report.Size(); ++i) {
+            const VectorSiteReport& entry = report[i];
+            const uint64_t id = i + 1;
+            ProtoWriter values;
+            for(const size_t value : {entry.live_vectors, entry.live_bytes, entry.allocated_bytes, entry.wasted_bytes,
+                                      entry.reallocations}) {
+                values.Varint(value);
+            }
+            ProtoWriter location_ids;
+            location_ids.Varint(id);
+            ProtoWriter sample;
+            sample.Bytes(1, location_ids.Str());
+            sample.Bytes(2, values.Str());
+            profile.Bytes(2, sample.Str());
+
+            ProtoWriter line;
+            line.Uint(1, id);
+            line.Uint(2, entry.site.line);
+            ProtoWriter location;
+            location.Uint(1, id);
+            location.Bytes(4, line.Str());
+            profile.Bytes(4, location.Str());
+
+            const std::string_view name = *entry.site.function != '\0' ? entry.site.function : "<unnamed>";
+            ProtoWriter function;
+            function.Uint(1, id);
+            function.Uint(2, intern(name));
+            function.Uint(3, intern(name));
+            function.Uint(4, intern(entry.site.file));
+            profile.Bytes(5, function.Str());
+        }
+
+        for(const std::string_view text : strings) {
+            profile.Bytes(6, text);
+        }
+        out.write(profile.Str().data(), static_cast<std::streamsize>(profile.Str().size()));
+    }
+};